@@ -0,0 +1,92 @@
+#include "mbed.h"
+#include "clk_gate.h"
+#include "lp_ticker_api.h"
+
+/* Max number of modules tracked */
+#define CLK_GATE_MAX_MODULES        8
+
+struct ClkGateEntry {
+    uint32_t        module;
+    uint16_t        ref_count;
+    /* Clock on-time accounting */
+    us_timestamp_t  on_since_us;
+    us_timestamp_t  on_total_us;
+};
+
+static ClkGateEntry clk_gate_arr[CLK_GATE_MAX_MODULES];
+static size_t clk_gate_num = 0;
+
+static ClkGateEntry *clk_gate_find(uint32_t module, bool create);
+static us_timestamp_t clk_gate_now_us(void);
+
+void clk_gate_acquire(uint32_t module)
+{
+    CriticalSectionLock lock;
+
+    ClkGateEntry *entry = clk_gate_find(module, true);
+    MBED_ASSERT(entry);
+
+    if (entry->ref_count ++ == 0) {
+        CLK_EnableModuleClock(module);
+        entry->on_since_us = clk_gate_now_us();
+    }
+}
+
+void clk_gate_release(uint32_t module)
+{
+    CriticalSectionLock lock;
+
+    ClkGateEntry *entry = clk_gate_find(module, false);
+    MBED_ASSERT(entry && entry->ref_count);
+
+    if (-- entry->ref_count == 0) {
+        CLK_DisableModuleClock(module);
+        entry->on_total_us += clk_gate_now_us() - entry->on_since_us;
+    }
+}
+
+void clk_gate_dump_stats(void)
+{
+    us_timestamp_t now_us = clk_gate_now_us();
+
+    for (size_t i = 0; i < clk_gate_num; i ++) {
+        ClkGateEntry entry;
+        {
+            CriticalSectionLock lock;
+            entry = clk_gate_arr[i];
+        }
+
+        us_timestamp_t on_us = entry.on_total_us;
+        if (entry.ref_count) {
+            on_us += now_us - entry.on_since_us;
+        }
+        printf("Module clock 0x%08lx: ref %u, on %llu ms of %llu ms\n", (unsigned long) entry.module,
+               entry.ref_count, on_us / 1000, now_us / 1000);
+    }
+}
+
+/* NOTE: Caller must be in critical section. */
+static ClkGateEntry *clk_gate_find(uint32_t module, bool create)
+{
+    for (size_t i = 0; i < clk_gate_num; i ++) {
+        if (clk_gate_arr[i].module == module) {
+            return clk_gate_arr + i;
+        }
+    }
+
+    if (! create || clk_gate_num >= CLK_GATE_MAX_MODULES) {
+        return NULL;
+    }
+
+    ClkGateEntry *entry = clk_gate_arr + clk_gate_num ++;
+    memset(entry, 0x00, sizeof (*entry));
+    entry->module = module;
+
+    return entry;
+}
+
+static us_timestamp_t clk_gate_now_us(void)
+{
+    /* lp_ticker keeps counting across power-down mode (deep sleep) */
+    return ticker_read_us(get_lp_ticker_data());
+}
@@ -0,0 +1,23 @@
+#ifndef __CLK_GATE_H__
+#define __CLK_GATE_H__
+
+#include "mbed.h"
+
+/* Reference-counted peripheral clock gating
+ *
+ * Module clock is enabled on first acquire and gated on last release. The module argument is the Nuvoton
+ * BSP module index, e.g. WDT_MODULE, UART0_MODULE. Time with module clock enabled is accounted per module.
+ *
+ * Module clock which is already enabled before (e.g. by Mbed OS HAL) can be taken over by acquiring it once.
+ *
+ * NOTE: Clock sources are left as they are across power-down mode (deep sleep). Wake-capable modules in this
+ *       example need no switch: WDT is clocked by LIRC, RTC by LXT, and UART CTS/I2C address match wake-up
+ *       don't need module clock.
+ */
+void clk_gate_acquire(uint32_t module);
+void clk_gate_release(uint32_t module);
+
+/* Print per-module reference count and clock on-time */
+void clk_gate_dump_stats(void);
+
+#endif  // __CLK_GATE_H__
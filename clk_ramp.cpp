@@ -0,0 +1,195 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "clk_ramp.h"
+#include "lp_ticker_api.h"
+
+/* HCLK from PLL and PLL control are alike on these targets. NANO100 differs in register layout and M251 has
+ * no PLL, so they always run at full clock.
+ *
+ * Switching clock needs hooks around power-down mode, which only customized idle handler provides. Mbed OS
+ * internal idle handler (MBED_TICKLESS) has none, so there the system always runs at full clock. */
+#if (defined(TARGET_NUC472) || defined(TARGET_M451) || defined(TARGET_M480) || defined(TARGET_M460) || defined(TARGET_M261)) && \
+    (! defined(MBED_TICKLESS))
+#define NU_CLK_RAMP_SUPPORTED       MBED_CONF_APP_LAZY_CLOCK_RAMP
+#else
+#define NU_CLK_RAMP_SUPPORTED       0
+#endif
+
+struct ClkRampStats {
+    uint32_t        wakes;
+    uint32_t        ramps;
+    us_timestamp_t  awake_us;
+    us_timestamp_t  low_clock_us;
+    us_timestamp_t  ramp_us;
+};
+
+/* Per wake-up type, attributed by the lowest bit set on wake-up */
+static ClkRampStats stats_arr[NU_WAKEUP_TYPE_NUM];
+
+/* Current awake period */
+static bool awake_tracked = false;
+static int wakeup_type = 0;
+static us_timestamp_t wakeup_ts_us = 0;
+static us_timestamp_t ramp_ts_us = 0;
+static bool low_clock = false;
+/* PLL is being waited for by clk_ramp_request() */
+static bool ramping = false;
+
+#if NU_CLK_RAMP_SUPPORTED
+/* HCLK/PLL configuration to restore on ramp-up */
+static uint32_t saved_hclksel;
+static uint32_t saved_hclkdiv;
+static uint32_t saved_pllctl;
+
+static LowPowerTimeout ramp_timeout;
+
+static void clk_ramp_update_systick(void);
+#endif
+
+static us_timestamp_t clk_ramp_now_us(void);
+
+void clk_ramp_enter_powerdown(void)
+{
+    us_timestamp_t now_us = clk_ramp_now_us();
+
+    /* Close the awake period since last wake-up */
+    if (awake_tracked) {
+        CriticalSectionLock lock;
+
+        ClkRampStats *stats = stats_arr + wakeup_type;
+        stats->awake_us += now_us - wakeup_ts_us;
+        stats->low_clock_us += (low_clock ? now_us : ramp_ts_us) - wakeup_ts_us;
+        awake_tracked = false;
+    }
+
+#if NU_CLK_RAMP_SUPPORTED
+    ramp_timeout.detach();
+
+    CriticalSectionLock lock;
+
+    if (low_clock) {
+        return;
+    }
+
+    saved_hclksel = CLK->CLKSEL0 & CLK_CLKSEL0_HCLKSEL_Msk;
+    saved_hclkdiv = CLK->CLKDIV0 & CLK_CLKDIV0_HCLKDIV_Msk;
+    saved_pllctl = CLK->PLLCTL;
+
+    /* Nothing to gain unless HCLK is from PLL */
+    if (saved_hclksel != CLK_CLKSEL0_HCLKSEL_PLL) {
+        return;
+    }
+
+    /* NOTE: Peripherals clocked by HCLK/PCLK (e.g. I2C, and us_ticker on some targets) run slower at low
+     *       clock. Waits get longer, not shorter. Handlers relying on them must call clk_ramp_request(). */
+    SYS_UnlockReg();
+    CLK_SetHCLK(CLK_CLKSEL0_HCLKSEL_HIRC, CLK_CLKDIV0_HCLK(1));
+    CLK_DisablePLL();
+    SYS_LockReg();
+    clk_ramp_update_systick();
+
+    low_clock = true;
+#endif
+}
+
+void clk_ramp_exit_powerdown(void)
+{
+    /* Interrupt handlers of wake-up sources have run. Attribute this wake-up by the events they have
+     * accounted, including ISR-only ones which never reach wakeup_eventflags. */
+    uint32_t flags = wakeup_pdwu_sources();
+
+    {
+        CriticalSectionLock lock;
+
+        wakeup_type = __builtin_ctz(flags);
+        wakeup_ts_us = clk_ramp_now_us();
+        ramp_ts_us = wakeup_ts_us;
+        stats_arr[wakeup_type].wakes ++;
+        awake_tracked = true;
+    }
+
+#if NU_CLK_RAMP_SUPPORTED
+    if (low_clock) {
+        ramp_timeout.attach_us(&clk_ramp_request, MBED_CONF_APP_LAZY_CLOCK_RAMP_THRESHOLD_US);
+    }
+#endif
+}
+
+void clk_ramp_request(void)
+{
+#if NU_CLK_RAMP_SUPPORTED
+    us_timestamp_t start_us;
+
+    {
+        CriticalSectionLock lock;
+
+        /* Already at full clock, or ramp in progress by preempted caller */
+        if (! low_clock || ramping) {
+            return;
+        }
+        ramping = true;
+
+        start_us = clk_ramp_now_us();
+
+        SYS_UnlockReg();
+        CLK->PLLCTL = saved_pllctl;
+        SYS_LockReg();
+    }
+
+    /* Wait for PLL stable with interrupts enabled. It takes hundreds of us. */
+    CLK_WaitClockReady(CLK_STATUS_PLLSTB_Msk);
+
+    CriticalSectionLock lock;
+
+    SYS_UnlockReg();
+    CLK_SetHCLK(saved_hclksel, saved_hclkdiv);
+    SYS_LockReg();
+    clk_ramp_update_systick();
+
+    low_clock = false;
+    ramping = false;
+    ramp_ts_us = clk_ramp_now_us();
+
+    if (awake_tracked) {
+        ClkRampStats *stats = stats_arr + wakeup_type;
+        stats->ramps ++;
+        stats->ramp_us += ramp_ts_us - start_us;
+    }
+#endif
+}
+
+void clk_ramp_dump_stats(void)
+{
+    for (int type = 0; type < NU_WAKEUP_TYPE_NUM; type ++) {
+        ClkRampStats stats;
+        {
+            CriticalSectionLock lock;
+            stats = stats_arr[type];
+        }
+
+        if (stats.wakes == 0) {
+            continue;
+        }
+        printf("Wake-up 0x%03x: %lu wakes, awake avg %llu us (low clock %llu us), %lu ramps avg %llu us\n",
+               1 << type, (unsigned long) stats.wakes, stats.awake_us / stats.wakes,
+               stats.low_clock_us / stats.wakes, (unsigned long) stats.ramps,
+               stats.ramps ? (stats.ramp_us / stats.ramps) : 0);
+    }
+}
+
+#if NU_CLK_RAMP_SUPPORTED
+/* SysTick is clocked by HCLK. Rescale it on HCLK switch to keep OS tick period, or ticks stretch by
+ * PLL/HIRC (~16x) at low clock.
+ *
+ * NOTE: Caller must be in critical section. SystemCoreClock has been updated by CLK_SetHCLK(). */
+static void clk_ramp_update_systick(void)
+{
+    SysTick->LOAD = SystemCoreClock / OS_TICK_FREQ - 1;
+    SysTick->VAL = 0;
+}
+#endif
+
+static us_timestamp_t clk_ramp_now_us(void)
+{
+    return ticker_read_us(get_lp_ticker_data());
+}
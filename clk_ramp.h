@@ -0,0 +1,27 @@
+#ifndef __CLK_RAMP_H__
+#define __CLK_RAMP_H__
+
+#include "mbed.h"
+
+/* Lazy clock ramp-up after power-down wake-up
+ *
+ * Before power-down, HCLK is switched from PLL to HIRC and PLL is disabled, so the system resumes on HIRC
+ * without waiting for PLL. Wake-up attribution and trivial handlers (e.g. WDT counter reset, RTC alarm
+ * re-arm) run at low clock. HCLK ramps up to PLL only when some handler asks for it through
+ * clk_ramp_request() or the awake period exceeds app.lazy-clock-ramp-threshold-us.
+ *
+ * Enabled by app.lazy-clock-ramp, with customized idle handler only (not MBED_TICKLESS). Awake time at
+ * low/full clock and ramp latency are accounted per wake-up type either way, so that the two can be compared.
+ */
+
+/* Called by idle handler around power-down mode */
+void clk_ramp_enter_powerdown(void);
+void clk_ramp_exit_powerdown(void);
+
+/* Ramp HCLK up to PLL if running at low clock. Callable in interrupt context. */
+void clk_ramp_request(void);
+
+/* Print awake time and ramp latency per wake-up type */
+void clk_ramp_dump_stats(void);
+
+#endif  // __CLK_RAMP_H__
@@ -3,9 +3,45 @@
 #include <vector>
 
 #include "wakeup.h"
+#include "pm_qos.h"
+#include "clk_gate.h"
+#include "pwrmode.h"
+#include "clk_ramp.h"
+#include "trace.h"
+#include "wake_coro.h"
+#include "nu_modutil.h"
+
+/* UART module clocks, to look up STDIO UART's */
+static const struct nu_modinit_s stdio_uart_modinit_tab[] = {
+    {UART_0, UART0_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+    {UART_1, UART1_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+#if (! defined(TARGET_NANO100))
+    {UART_2, UART2_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+#endif
+#if defined(TARGET_NUC472) || defined(TARGET_M451) || defined(TARGET_M480) || defined(TARGET_M460) || defined(TARGET_M261)
+    {UART_3, UART3_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+#endif
+#if defined(TARGET_NUC472) || defined(TARGET_M480) || defined(TARGET_M460) || defined(TARGET_M261)
+    {UART_4, UART4_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+    {UART_5, UART5_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+#endif
+#if defined(TARGET_M460)
+    {UART_6, UART6_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+    {UART_7, UART7_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+    {UART_8, UART8_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+    {UART_9, UART9_MODULE, 0, 0, 0, (IRQn_Type) 0, NULL},
+#endif
+
+    {NC, 0, 0, 0, 0, (IRQn_Type) 0, NULL}
+};
+
+/* STDIO UART module clock, e.g. UART0_MODULE */
+static uint32_t stdio_uart_module;
 
 static void flush_stdio_uart_fifo(void);
 static void check_wakeup_source(uint32_t, bool deepsleep);
+static void report_button_gesture(uint32_t flags);
+static void report_sensor_batch(void);
 #if (! defined(MBED_TICKLESS))
 static void idle_hdlr(void);
 #endif
@@ -16,13 +52,26 @@ int main() {
 #ifdef MBED_MAJOR_VERSION
     printf("Mbed OS version %d.%d.%d\r\n\n", MBED_MAJOR_VERSION, MBED_MINOR_VERSION, MBED_PATCH_VERSION);
 #endif
+    /* Take over STDIO UART clock, which has been enabled by Mbed OS, so that it can be gated across sleep */
+    const struct nu_modinit_s *stdio_uart_modinit = get_modinit(STDIO_UART, stdio_uart_modinit_tab);
+    MBED_ASSERT(stdio_uart_modinit != NULL);
+    stdio_uart_module = stdio_uart_modinit->clkidx;
+    clk_gate_acquire(stdio_uart_module);
+    /* Power-down modes which reset on wake-up are not allowed, so there is no state to restore. Still clear
+     * PMU wake-up status and tell such a boot. */
+    if (pwrmode_boot()) {
+        printf("Boot on wake-up from standby/deep power-down\n");
+    }
     config_pwrctl();
     config_button_wakeup();
     config_wdt_wakeup();
     config_rtc_wakeup();
+    config_sensor_batch_wakeup();
     /* TODO */
     //config_uart_wakeup();
     //config_i2c_wakeup();
+    /* Wake-up sources are now known. Re-evaluate power-down mode. */
+    pm_qos_refresh();
     
 #if defined(MBED_TICKLESS)
     /* Run Mbed OS internal idle handler */
@@ -31,6 +80,8 @@ int main() {
     rtos::Kernel::attach_idle_hook(idle_hdlr);
 #endif
 
+    TRACE_BEGIN(TraceEvent_Thread_Main);
+
     while (true) {
         
         printf("I am going to shallow/deep sleep\n");
@@ -39,7 +90,11 @@ int main() {
         flush_stdio_uart_fifo();
         
         /* Wait for any wake-up event */
+        TRACE_END(TraceEvent_Thread_Main);
         uint32_t flags = wakeup_eventflags.wait_any(EventFlag_Wakeup_All, osWaitForever, true);
+        TRACE_BEGIN(TraceEvent_Thread_Main);
+        /* Printing and the like below are not trivial. Run at full clock. */
+        clk_ramp_request();
         if (flags & osFlagsError) {
             if (flags != osFlagsErrorTimeout) {
                 printf("OS error code: 0x%08lX\n", flags);
@@ -94,6 +149,29 @@ int main() {
             flags &= ~EventFlag_Wakeup_UnID;
         }
         check_wakeup_source(flags, deepsleep);
+
+        report_button_gesture(flags);
+
+        if (flags & EventFlag_Wakeup_SensorBatch) {
+            report_sensor_batch();
+        }
+
+        /* RTC alarm re-armed in interrupt context (ISR-only) cannot print its error there */
+        const char *rtc_error = rtc_alarm_error_fetch();
+        if (rtc_error) {
+            printf("RTC alarm re-arm failed: %s\n", rtc_error);
+        }
+
+        if (flags & EventFlag_Wakeup_Storm) {
+            printf("Wake-up storm: throttle 0x%03lx\n", (unsigned long) wakeup_storm_fetch());
+        }
+
+#if MBED_CONF_APP_TRACE_ENABLE
+        /* Dump trace when buffer gets half full */
+        if (trace_pending() >= (MBED_CONF_APP_TRACE_BUFFER_SIZE / 2)) {
+            trace_dump();
+        }
+#endif
         
         printf("\n");
     }
@@ -120,10 +198,14 @@ void check_wakeup_source(uint32_t flags, bool deepsleep)
         WakeupName(EventFlag_Wakeup_RTC_Alarm, "RTC alarm"),
         WakeupName(EventFlag_Wakeup_UART_CTS, "UART CTS"),
         WakeupName(EventFlag_Wakeup_I2C_AddrMatch, "I2C address match"),
+        WakeupName(EventFlag_Wakeup_SensorBatch, "Sensor batch"),
+        WakeupName(EventFlag_Wakeup_Storm, "Wake-up storm"),
         
         WakeupName(EventFlag_Wakeup_UnID, "Unidentified"),
     };
     
+    TRACE_BEGIN(TraceEvent_Check_Wakeup_Source);
+
     const char *sleep_mode = deepsleep ? "deep sleep" : "shallow sleep";
     
     if (flags) {
@@ -136,17 +218,99 @@ void check_wakeup_source(uint32_t flags, bool deepsleep)
             }
         }
     }
+
+    TRACE_END(TraceEvent_Check_Wakeup_Source);
+}
+
+void report_button_gesture(uint32_t flags)
+{
+    static const char *gesture_name_arr[] = {
+        "none",                     // ButtonGesture_None
+        "short press",              // ButtonGesture_Short
+        "long press",               // ButtonGesture_Long
+        "double click",             // ButtonGesture_Double
+        "hold repeat",              // ButtonGesture_HoldRepeat
+    };
+    
+    if (flags & EventFlag_Wakeup_Button1) {
+        ButtonGesture gesture = button_gesture_fetch(EventFlag_Wakeup_Button1);
+        printf("Button1 gesture: %s\n", gesture_name_arr[gesture]);
+        
+        /* Long press on Button1 also dumps sleep residency statistics */
+        if (gesture == ButtonGesture_Long) {
+            pwrmode_dump_stats();
+            clk_ramp_dump_stats();
+            wakeup_dump_stats();
+            wakeup_storm_dump_stats();
+            wake_coro_dump_stats();
+        }
+    }
+    
+    if (flags & EventFlag_Wakeup_Button2) {
+        ButtonGesture gesture = button_gesture_fetch(EventFlag_Wakeup_Button2);
+        printf("Button2 gesture: %s\n", gesture_name_arr[gesture]);
+        
+        /* Long press on Button2 also dumps peripheral clock statistics */
+        if (gesture == ButtonGesture_Long) {
+            clk_gate_dump_stats();
+        }
+    }
+}
+
+void report_sensor_batch(void)
+{
+    static uint16_t batch[MBED_CONF_APP_SENSOR_BATCH_SIZE];
+    
+    size_t n_samples = sensor_batch_fetch(batch, sizeof (batch) / sizeof (batch[0]));
+    if (n_samples == 0) {
+        return;
+    }
+    
+    uint16_t sample_min = UINT16_MAX;
+    uint16_t sample_max = 0;
+    uint32_t sample_sum = 0;
+    for (size_t i = 0; i < n_samples; i ++) {
+        sample_min = (batch[i] < sample_min) ? batch[i] : sample_min;
+        sample_max = (batch[i] > sample_max) ? batch[i] : sample_max;
+        sample_sum += batch[i];
+    }
+    
+    printf("Sensor batch: %u samples, min %u, max %u, avg %lu\n", (unsigned) n_samples, sample_min, sample_max,
+           (unsigned long) (sample_sum / n_samples));
 }
 
 #if (! defined(MBED_TICKLESS))
 
 #define US_PER_SEC              (1000 * 1000)
 #define US_PER_OS_TICK          (US_PER_SEC / OS_TICK_FREQ)
+/* SRAM needed retained across power-down modes which reset on wake-up. None without save hook. */
+#define RESET_RETAIN_BYTES      0
 
-void dummy_cb(void) {}
+/* Set when lp_ticker alarm fires, meaning OS tick is due */
+static volatile bool alarm_fired;
+
+void alarm_cb(void)
+{
+    alarm_fired = true;
+}
 
 void idle_hdlr(void) {
     
+    /* Pick the deepest sleep state which fits latency tolerance requests */
+    PmState pm_state = pm_qos_select_state();
+    if (pm_state == PmState_Active) {
+        return;
+    }
+
+    /* Pick the deepest power-down mode which fits wake-up sources, SRAM retention policy and latency */
+    int pwrmode = -1;
+    if (pm_state == PmState_PowerDown) {
+        pwrmode = pwrmode_select(pm_qos_max_latency_us(), true, RESET_RETAIN_BYTES);
+        if (pwrmode < 0) {
+            pm_state = PmState_Idle;
+        }
+    }
+
     const int max_us_sleep = (INT_MAX / OS_TICK_FREQ) * OS_TICK_FREQ; 
     /* Keep track of the time asleep */
     LowPowerTimer asleep_watch;
@@ -166,13 +330,48 @@ void idle_hdlr(void) {
 
         /* Start the asleep_watch and setup the alarm_clock to wake up the system in us_to_sleep */
         asleep_watch.start();
-        alarm_clock.attach_us(dummy_cb, us_to_sleep);
+        alarm_fired = false;
+        alarm_clock.attach_us(alarm_cb, us_to_sleep);
+
+        /* Gate STDIO UART clock unless it is still transmitting */
+        UART_T *stdio_uart_base = (UART_T *) NU_MODBASE(STDIO_UART);
+        bool stdio_uart_gated = UART_IS_TX_EMPTY(stdio_uart_base);
+        if (stdio_uart_gated) {
+            clk_gate_release(stdio_uart_module);
+        }
 
-        /* Go to deep sleep */
-        hal_deepsleep();
-            
-        /* Woken up by lp_ticker or other wake-up event */
-        int us_asleep = asleep_watch.read_us();
+        int us_asleep;
+        int us_sleep_start = 0;
+        while (true) {
+            /* Go to deep/shallow sleep */
+            if (pm_state == PmState_PowerDown) {
+                clk_ramp_enter_powerdown();
+                pwrmode_prepare(pwrmode);
+                TRACE_BEGIN(TraceEvent_Sleep_PowerDown);
+                hal_deepsleep();
+                TRACE_END(TraceEvent_Sleep_PowerDown);
+                /* Resume on HIRC with lazy clock ramp-up */
+                clk_ramp_exit_powerdown();
+            } else {
+                TRACE_BEGIN(TraceEvent_Sleep_Idle);
+                hal_sleep();
+                TRACE_END(TraceEvent_Sleep_Idle);
+            }
+
+            /* Woken up by lp_ticker or other wake-up event */
+            us_asleep = asleep_watch.read_us();
+            pwrmode_account(pwrmode, us_asleep - us_sleep_start);
+
+            /* Go back to sleep directly, without resuming kernel, if the wake-up was ISR-only */
+            if (! wakeup_sleep_on_exit(alarm_fired)) {
+                break;
+            }
+            us_sleep_start = asleep_watch.read_us();
+        }
+
+        if (stdio_uart_gated) {
+            clk_gate_acquire(stdio_uart_module);
+        }
 
         /* Clean up asleep_watch and alarm_clock */
         asleep_watch.stop();
@@ -0,0 +1,161 @@
+#include "mbed.h"
+#include "pm_qos.h"
+#include "pwrmode.h"
+
+/* Exit latency of Idle mode
+ *
+ * NOTE: These are conservative estimates. Tune them with measurement on real board. Exit latencies of
+ *       power-down modes are described in pwrmode.cpp.
+ */
+#if defined(TARGET_NANO100)
+#define NU_IDLE_EXIT_LATENCY_US         10
+#else
+#define NU_IDLE_EXIT_LATENCY_US         5
+#endif
+
+/* Active requests */
+static PmQosRequest *req_head = NULL;
+/* Whether we hold deep sleep lock for Mbed OS internal idle handler */
+static bool deep_sleep_locked = false;
+
+static void pm_qos_update_constraints(void);
+
+PmQosRequest::PmQosRequest() :
+    _max_latency_us(PM_QOS_LATENCY_ANY),
+    _active(false),
+    _next(NULL)
+{
+}
+
+PmQosRequest::~PmQosRequest()
+{
+    remove();
+}
+
+void PmQosRequest::add(uint32_t max_latency_us, uint32_t duration_us)
+{
+    CriticalSectionLock lock;
+
+    /* Cancel pending expiry first, so that it cannot remove the request being added */
+    _expiry.detach();
+
+    _max_latency_us = max_latency_us;
+    if (! _active) {
+        _active = true;
+        _next = req_head;
+        req_head = this;
+    }
+    pm_qos_update_constraints();
+
+    if (duration_us) {
+        _expiry.attach_us(callback(this, &PmQosRequest::remove), duration_us);
+    }
+}
+
+void PmQosRequest::update(uint32_t max_latency_us)
+{
+    CriticalSectionLock lock;
+
+    if (_active) {
+        _max_latency_us = max_latency_us;
+        pm_qos_update_constraints();
+    }
+}
+
+void PmQosRequest::remove(void)
+{
+    _expiry.detach();
+
+    CriticalSectionLock lock;
+
+    if (! _active) {
+        return;
+    }
+
+    PmQosRequest **req_pos = &req_head;
+    while (*req_pos != this) {
+        req_pos = &(*req_pos)->_next;
+    }
+    *req_pos = _next;
+    _next = NULL;
+    _active = false;
+
+    pm_qos_update_constraints();
+}
+
+uint32_t pm_qos_max_latency_us(void)
+{
+    CriticalSectionLock lock;
+
+    uint32_t max_latency_us = PM_QOS_LATENCY_ANY;
+    for (const PmQosRequest *req = req_head; req; req = req->_next) {
+        if (req->_max_latency_us < max_latency_us) {
+            max_latency_us = req->_max_latency_us;
+        }
+    }
+
+    return max_latency_us;
+}
+
+uint32_t pm_qos_exit_latency_us(PmState state)
+{
+    switch (state) {
+        case PmState_Idle:
+            return NU_IDLE_EXIT_LATENCY_US;
+
+        case PmState_PowerDown:
+            /* The shallowest power-down mode */
+            return pwrmode_min_exit_latency_us();
+
+        default:
+            return 0;
+    }
+}
+
+PmState pm_qos_select_state(void)
+{
+    uint32_t max_latency_us = pm_qos_max_latency_us();
+
+    if (max_latency_us >= pm_qos_exit_latency_us(PmState_PowerDown)) {
+        return PmState_PowerDown;
+    } else if (max_latency_us >= pm_qos_exit_latency_us(PmState_Idle)) {
+        return PmState_Idle;
+    } else {
+        return PmState_Active;
+    }
+}
+
+void pm_qos_refresh(void)
+{
+    CriticalSectionLock lock;
+
+    pm_qos_update_constraints();
+}
+
+/* Mbed OS internal idle handler (MBED_TICKLESS) consults sleep manager rather than us. Hold deep sleep lock
+ * to keep it out of Power-down mode when some request cannot tolerate its exit latency, and program the
+ * power-down mode which fits for it. Modes which reset on wake-up are excluded because it has no chance to
+ * call save hook.
+ *
+ * NOTE: Sleep manager has no means to disable sleep at all, so PmState_Active degrades to PmState_Idle
+ *       on this path.
+ *
+ * NOTE: Caller must be in critical section.
+ */
+static void pm_qos_update_constraints(void)
+{
+    int pwrmode = pwrmode_select(pm_qos_max_latency_us(), false, 0);
+    if (pwrmode >= 0) {
+        pwrmode_prepare(pwrmode);
+    }
+
+    bool lock_deep_sleep = (pwrmode < 0);
+
+    if (lock_deep_sleep && ! deep_sleep_locked) {
+        sleep_manager_lock_deep_sleep();
+        deep_sleep_locked = true;
+    } else if (! lock_deep_sleep && deep_sleep_locked) {
+        sleep_manager_unlock_deep_sleep();
+        deep_sleep_locked = false;
+    }
+}
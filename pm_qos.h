@@ -0,0 +1,58 @@
+#ifndef __PM_QOS_H__
+#define __PM_QOS_H__
+
+#include "mbed.h"
+
+/* Sleep states which the idle path can choose from, ordered from shallowest to deepest */
+enum PmState {
+    PmState_Active          = 0,    // Don't sleep
+    PmState_Idle,                   // Idle mode (shallow sleep)
+    PmState_PowerDown,              // Power-down mode (deep sleep)
+};
+
+/* Latency value which means "no constraint" */
+#define PM_QOS_LATENCY_ANY  UINT32_MAX
+
+/* Latency tolerance (PM QoS) request
+ *
+ * A subsystem declares the maximum wake-up latency it can tolerate with one request object. The idle path
+ * honors the tightest one among all active requests by picking the deepest sleep state whose exit latency
+ * fits. The request object must stay alive while it is active.
+ */
+class PmQosRequest : private NonCopyable<PmQosRequest> {
+public:
+    PmQosRequest();
+    ~PmQosRequest();
+
+    /* Activate the request with max_latency_us. With duration_us non-zero, the request removes itself
+     * automatically after duration_us. Re-adding an active request just updates it. */
+    void add(uint32_t max_latency_us, uint32_t duration_us = 0);
+    /* Change max latency of an active request */
+    void update(uint32_t max_latency_us);
+    /* Deactivate the request */
+    void remove(void);
+
+    bool active(void) const
+    {
+        return _active;
+    }
+
+private:
+    friend uint32_t pm_qos_max_latency_us(void);
+
+    uint32_t            _max_latency_us;
+    bool                _active;
+    PmQosRequest *      _next;
+    LowPowerTimeout     _expiry;
+};
+
+/* Tightest latency among all active requests, or PM_QOS_LATENCY_ANY if none */
+uint32_t pm_qos_max_latency_us(void);
+/* Exit latency of the sleep state on this target */
+uint32_t pm_qos_exit_latency_us(PmState state);
+/* Deepest sleep state whose exit latency fits all active requests */
+PmState pm_qos_select_state(void);
+/* Re-evaluate constraints for Mbed OS internal idle handler, e.g. after wake-up sources change */
+void pm_qos_refresh(void);
+
+#endif  // __PM_QOS_H__
@@ -0,0 +1,244 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "pwrmode.h"
+
+/* Wake-up sources able to wake up from normal power-down mode */
+#define NU_WAKEUP_ALL       (EventFlag_Wakeup_All & ~EventFlag_Wakeup_UnID)
+/* Whole SRAM, retained by modes which resume */
+#define NU_SRAM_ALL         UINT32_MAX
+
+/* Power-down mode descriptions
+ *
+ * NOTE: Exit latencies are conservative estimates, covering H/W wake-up delay, HXT/PLL stabilization and
+ *       Mbed OS HAL clock restore. For modes which don't resume, they cover chip boot up to main(). Tune
+ *       them with measurement on real board.
+ */
+#if defined(TARGET_M480) || defined(TARGET_M261)
+#define NU_PWRMODE_PROGRAMMABLE     1
+
+/* Reachable modes
+ *
+ * lp_ticker can only wake up from FWPD/NPD/LLPD. It is in use as long as Mbed OS schedules time (OS tick,
+ * timeouts), so only these modes are reachable by default. SPD0/SPD1/DPD, which reset on wake-up, are
+ * reachable only after the application both disables EventFlag_Wakeup_LPTicker (nothing timed pending
+ * but the RTC alarm, e.g. shipping mode) and allows reset through pwrmode_allow_reset(). SPD0 is selected
+ * over the deeper SPD1/DPD only when the save hook needs SRAM retained. See pwrmode_reachable() and
+ * tests/host/test_pwrmode.cpp.
+ *
+ * Wake-up from SPD0/SPD1/DPD is told at boot by wake-up flags in CLK->PMUSTS, which other modes don't set.
+ *
+ * NOTE: SPD0 retention is the first 16 KB of SRAM on M480/M261 by default. Save hook must place its state
+ *       there, e.g. by linker section.
+ */
+#define NU_SPD0_RETAINED_SRAM       (16 * 1024)
+
+static const PwrModeDesc pwrmode_arr[] = {
+    /* Fast wake-up power-down mode */
+    {"FWPD", CLK_PMUCTL_PDMSEL_FWPD, NU_WAKEUP_ALL, 300, true, NU_SRAM_ALL},
+    /* Normal power-down mode */
+    {"NPD", CLK_PMUCTL_PDMSEL_PD, NU_WAKEUP_ALL, 800, true, NU_SRAM_ALL},
+    /* Low leakage power-down mode */
+    {"LLPD", CLK_PMUCTL_PDMSEL_LLPD, NU_WAKEUP_ALL, 1200, true, NU_SRAM_ALL},
+    /* Standby power-down mode with partial SRAM retention. Peripherals but RTC and wake-up pins are off. */
+    {"SPD0", CLK_PMUCTL_PDMSEL_SPD0, EventFlag_Wakeup_RTC_Alarm, 5000, false, NU_SPD0_RETAINED_SRAM},
+    /* Standby power-down mode without SRAM retention */
+    {"SPD1", CLK_PMUCTL_PDMSEL_SPD1, EventFlag_Wakeup_RTC_Alarm, 5000, false, 0},
+    /* Deep power-down mode */
+    {"DPD", CLK_PMUCTL_PDMSEL_DPD, EventFlag_Wakeup_RTC_Alarm, 8000, false, 0},
+};
+
+#else
+#define NU_PWRMODE_PROGRAMMABLE     0
+
+#if defined(TARGET_NANO100)
+#define NU_PD_EXIT_LATENCY_US       1500
+#elif defined(TARGET_NUC472) || defined(TARGET_M451)
+#define NU_PD_EXIT_LATENCY_US       1000
+#elif defined(TARGET_M460)
+#define NU_PD_EXIT_LATENCY_US       800
+#elif defined(TARGET_M251)
+/* No PLL. HIRC is fast to get stable. */
+#define NU_PD_EXIT_LATENCY_US       150
+#else
+#define NU_PD_EXIT_LATENCY_US       2000
+#endif
+
+static const PwrModeDesc pwrmode_arr[] = {
+    /* Normal power-down mode */
+    {"NPD", 0, NU_WAKEUP_ALL, NU_PD_EXIT_LATENCY_US, true, NU_SRAM_ALL},
+};
+
+#endif
+
+#define NU_PWRMODE_NUM      (sizeof (pwrmode_arr) / sizeof (pwrmode_arr[0]))
+
+/* lp_ticker is internal with tickless and always in use */
+static uint32_t wakeup_sources = EventFlag_Wakeup_LPTicker;
+static bool reset_allowed = false;
+static void (*reset_save_hook)(void) = NULL;
+static void (*reset_restore_hook)(void) = NULL;
+/* Mode last programmed by pwrmode_prepare() */
+static int prepared_mode = -1;
+
+/* Residency statistics */
+static uint64_t idle_us = 0;
+static uint32_t idle_entries = 0;
+static uint64_t pwrmode_us_arr[NU_PWRMODE_NUM];
+static uint32_t pwrmode_entries_arr[NU_PWRMODE_NUM];
+
+void pwrmode_enable_wakeup_source(uint32_t eventflag)
+{
+    core_util_atomic_fetch_or_u32(&wakeup_sources, eventflag);
+}
+
+void pwrmode_disable_wakeup_source(uint32_t eventflag)
+{
+    core_util_atomic_fetch_and_u32(&wakeup_sources, ~eventflag);
+}
+
+void pwrmode_allow_reset(bool allow, void (*save_hook)(void), void (*restore_hook)(void))
+{
+    CriticalSectionLock lock;
+
+    reset_allowed = allow;
+    reset_save_hook = save_hook;
+    reset_restore_hook = restore_hook;
+}
+
+bool pwrmode_boot(void)
+{
+#if NU_PWRMODE_PROGRAMMABLE
+    /* Wake-up flags are set only on wake-up from SPD0/SPD1/DPD. Clear them for next boot. */
+    if ((CLK->PMUSTS & ~CLK_PMUSTS_CLRWK_Msk) == 0) {
+        return false;
+    }
+    CLK->PMUSTS = CLK_PMUSTS_CLRWK_Msk;
+
+    if (reset_restore_hook) {
+        reset_restore_hook();
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t pwrmode_num(void)
+{
+    return NU_PWRMODE_NUM;
+}
+
+const PwrModeDesc *pwrmode_desc(int mode)
+{
+    return (mode >= 0 && (size_t) mode < NU_PWRMODE_NUM) ? (pwrmode_arr + mode) : NULL;
+}
+
+int pwrmode_select(uint32_t max_latency_us, bool allow_reset, uint32_t retain_bytes)
+{
+    uint32_t reachable = pwrmode_reachable(allow_reset, retain_bytes);
+
+    for (int mode = NU_PWRMODE_NUM - 1; mode >= 0; mode --) {
+        if ((reachable & (1 << mode)) && pwrmode_arr[mode].exit_latency_us <= max_latency_us) {
+            return mode;
+        }
+    }
+
+    return -1;
+}
+
+uint32_t pwrmode_reachable(bool allow_reset, uint32_t retain_bytes)
+{
+    uint32_t sources = core_util_atomic_load_u32(&wakeup_sources);
+    uint32_t reachable = 0;
+    allow_reset = allow_reset && reset_allowed;
+
+    for (size_t mode = 0; mode < NU_PWRMODE_NUM; mode ++) {
+        const PwrModeDesc *desc = pwrmode_arr + mode;
+
+        if ((sources & ~desc->wakeup_sources) == 0 &&
+            (desc->resumes || (allow_reset && desc->retained_sram >= retain_bytes))) {
+            reachable |= 1 << mode;
+        }
+    }
+
+    return reachable;
+}
+
+uint32_t pwrmode_min_exit_latency_us(void)
+{
+    uint32_t min_latency_us = UINT32_MAX;
+
+    for (size_t mode = 0; mode < NU_PWRMODE_NUM; mode ++) {
+        if (pwrmode_arr[mode].exit_latency_us < min_latency_us) {
+            min_latency_us = pwrmode_arr[mode].exit_latency_us;
+        }
+    }
+
+    return min_latency_us;
+}
+
+void pwrmode_prepare(int mode)
+{
+    const PwrModeDesc *desc = pwrmode_desc(mode);
+    MBED_ASSERT(desc);
+
+    if (! desc->resumes && reset_save_hook) {
+        reset_save_hook();
+    }
+
+    prepared_mode = mode;
+
+#if NU_PWRMODE_PROGRAMMABLE
+    SYS_UnlockReg();
+    CLK_SetPowerDownMode(desc->pdmsel);
+    SYS_LockReg();
+#endif
+}
+
+void pwrmode_account(int mode, uint32_t us)
+{
+    CriticalSectionLock lock;
+
+    if (mode < 0) {
+        idle_us += us;
+        idle_entries ++;
+    } else {
+        pwrmode_us_arr[mode] += us;
+        pwrmode_entries_arr[mode] ++;
+    }
+}
+
+void pwrmode_account_wakeup(void)
+{
+    CriticalSectionLock lock;
+
+    if (prepared_mode >= 0) {
+        pwrmode_entries_arr[prepared_mode] ++;
+    }
+}
+
+void pwrmode_dump_stats(void)
+{
+    uint64_t us;
+    uint32_t entries;
+
+    {
+        CriticalSectionLock lock;
+        us = idle_us;
+        entries = idle_entries;
+    }
+    printf("Residency Idle: %lu entries, %llu ms\n", (unsigned long) entries, us / 1000);
+
+    for (size_t mode = 0; mode < NU_PWRMODE_NUM; mode ++) {
+        {
+            CriticalSectionLock lock;
+            us = pwrmode_us_arr[mode];
+            entries = pwrmode_entries_arr[mode];
+        }
+        printf("Residency %s: %lu entries, %llu ms%s\n", pwrmode_arr[mode].name, (unsigned long) entries, us / 1000,
+               (pwrmode_reachable(true, 0) & (1 << mode)) ? "" : " (unreachable with wake-up sources in use)");
+    }
+#if defined(MBED_TICKLESS)
+    printf("Residency time needs customized idle handler. Entries are wake-ups from power-down.\n");
+#endif
+}
@@ -0,0 +1,62 @@
+#ifndef __PWRMODE_H__
+#define __PWRMODE_H__
+
+#include "mbed.h"
+
+/* Power-down mode flavors
+ *
+ * Some targets offer several power-down modes (normal, fast wake-up, low leakage, standby, deep power-down)
+ * with different current, exit latency, wake-up sources and SRAM retention. Per-target descriptions are in
+ * pwrmode.cpp. Targets without choice have one normal power-down mode.
+ *
+ * Modes are indexed from shallowest to deepest. Modes which don't resume (chip resets on wake-up) are
+ * only selected when the application allows it and they retain the SRAM it needs. The save hook is called
+ * before entering them, and the restore hook at boot after waking up from them.
+ */
+struct PwrModeDesc {
+    const char *    name;
+    /* CLK_PMUCTL_PDMSEL_xxx, not used on targets without choice */
+    uint32_t        pdmsel;
+    /* EventFlag_Wakeup_xxx able to wake up from this mode */
+    uint32_t        wakeup_sources;
+    uint32_t        exit_latency_us;
+    /* CPU and SRAM are retained and execution resumes on wake-up */
+    bool            resumes;
+    /* SRAM in bytes retained across modes which don't resume, counted from SRAM start */
+    uint32_t        retained_sram;
+};
+
+/* Wake-up sources in use. Mode incompatible with any of them is not selected. */
+void pwrmode_enable_wakeup_source(uint32_t eventflag);
+void pwrmode_disable_wakeup_source(uint32_t eventflag);
+
+/* Allow modes which reset on wake-up. save_hook is called to save needed state before entering them, and
+ * restore_hook by pwrmode_boot() after waking up from them. */
+void pwrmode_allow_reset(bool allow, void (*save_hook)(void), void (*restore_hook)(void));
+/* Call at boot, after pwrmode_allow_reset(). Return true and call restore hook if the chip has reset on
+ * wake-up from a mode which doesn't resume, as told by PMU status. */
+bool pwrmode_boot(void);
+
+/* Number of modes and their description */
+size_t pwrmode_num(void);
+const PwrModeDesc *pwrmode_desc(int mode);
+
+/* Deepest mode compatible with wake-up sources, reset policy and max_latency_us, or -1 if none. Modes which
+ * don't resume must retain at least retain_bytes of SRAM for the save hook. */
+int pwrmode_select(uint32_t max_latency_us, bool allow_reset, uint32_t retain_bytes);
+/* Modes (bit n for mode n) compatible with wake-up sources, reset policy and SRAM retention at any
+ * latency */
+uint32_t pwrmode_reachable(bool allow_reset, uint32_t retain_bytes);
+/* Shortest exit latency among all modes */
+uint32_t pwrmode_min_exit_latency_us(void);
+
+/* Program the mode for next power-down entry. Calls save hook for modes which don't resume. */
+void pwrmode_prepare(int mode);
+/* Account residency: mode -1 for Idle mode (shallow sleep) */
+void pwrmode_account(int mode, uint32_t us);
+/* Account one wake-up from the mode last prepared, without residency time. For Mbed OS internal idle
+ * handler (MBED_TICKLESS), which has no hook around sleep to call pwrmode_account(). */
+void pwrmode_account_wakeup(void);
+void pwrmode_dump_stats(void);
+
+#endif  // __PWRMODE_H__
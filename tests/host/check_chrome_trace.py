@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+#
+# Validate Chrome trace JSON converted by tools/trace2chrome.py from test_trace output
+#
+# Usage: check_chrome_trace.py <trace.json> <min span in us>
+
+import json
+import sys
+
+
+def check(trace, min_span_us):
+    errors = []
+    events = [event for event in trace['traceEvents'] if event['ph'] != 'M']
+    if not events:
+        return ['no events']
+
+    # Timestamps are unwrapped across 32-bit wrap-around and never step back
+    for prev, event in zip(events, events[1:]):
+        if event['ts'] < prev['ts']:
+            errors.append('timestamp steps back: %s -> %s' % (prev, event))
+    span_us = events[-1]['ts'] - events[0]['ts']
+    if span_us < min_span_us:
+        errors.append('span %d us shorter than %d us' % (span_us, min_span_us))
+
+    # Begin/end events pair up per track
+    stacks = {}
+    for event in events:
+        stack = stacks.setdefault(event['tid'], [])
+        if event['ph'] == 'B':
+            stack.append(event['name'])
+        elif event['ph'] == 'E':
+            if not stack or stack.pop() != event['name']:
+                errors.append('unpaired end: %s' % event)
+    for tid, stack in stacks.items():
+        if stack:
+            errors.append('unpaired begin on tid %d: %s' % (tid, stack))
+
+    # Each track is named
+    named = {event['tid'] for event in trace['traceEvents'] if event['ph'] == 'M' and event['name'] == 'thread_name'}
+    if named != set(stacks):
+        errors.append('unnamed tracks: %s' % (set(stacks) - named))
+
+    names = {event['name'] for event in events}
+    for name in ('Sensor sample', 'Button', 'main loop'):
+        if name not in names:
+            errors.append('missing event: %s' % name)
+
+    return errors
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.stderr.write('Usage: %s <trace.json> <min span in us>\n' % sys.argv[0])
+        return 1
+
+    with open(sys.argv[1]) as f:
+        trace = json.load(f)
+
+    errors = check(trace, int(sys.argv[2]))
+    for error in errors:
+        print(error)
+    print('FAIL' if errors else 'PASS')
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,246 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "analogin_api.h"
+#include "lp_ticker_api.h"
+#include "rtx_os.h"
+#include "sim.h"
+#include <vector>
+#include <algorithm>
+
+EventFlags wakeup_eventflags;
+osRtxInfo_t osRtxInfo;
+CLK_T sim_clk;
+SimStats sim_stats;
+
+static us_timestamp_t now_us = 0;
+static bool pdwu_pending = false;
+static std::vector<LowPowerTimeout *> timeout_list;
+static uint16_t (*adc_waveform)(us_timestamp_t now_us) = NULL;
+static int fail_count = 0;
+
+void core_util_critical_section_enter(void)
+{
+}
+
+void core_util_critical_section_exit(void)
+{
+}
+
+void SYS_UnlockReg(void)
+{
+}
+
+void SYS_LockReg(void)
+{
+}
+
+void CLK_SetPowerDownMode(uint32_t pdmsel)
+{
+    (void) pdmsel;
+}
+
+bool wakeup_pdwu_pending(void)
+{
+    return pdwu_pending;
+}
+
+struct ticker_data_t {
+};
+
+static const ticker_data_t sim_ticker = {};
+
+const ticker_data_t *get_lp_ticker_data(void)
+{
+    return &sim_ticker;
+}
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return &sim_ticker;
+}
+
+us_timestamp_t ticker_read_us(const ticker_data_t *ticker)
+{
+    (void) ticker;
+    return now_us;
+}
+
+void analogin_init(analogin_t *obj, PinName pin)
+{
+    obj->pin = pin;
+}
+
+uint16_t analogin_read_u16(analogin_t *obj)
+{
+    (void) obj;
+    return adc_waveform ? adc_waveform(now_us) : 0;
+}
+
+/* Constructed on first use, because InterruptIn objects under test are static too */
+static std::vector<InterruptIn *> &interrupt_in_list(void)
+{
+    static std::vector<InterruptIn *> list;
+    return list;
+}
+
+namespace mbed {
+
+InterruptIn::InterruptIn(PinName pin) : _pin(pin), _irq_enabled(true)
+{
+    interrupt_in_list().push_back(this);
+}
+
+InterruptIn::~InterruptIn()
+{
+    std::vector<InterruptIn *> &list = interrupt_in_list();
+    list.erase(std::remove(list.begin(), list.end(), this), list.end());
+}
+
+LowPowerTimeout::LowPowerTimeout() : _deadline_us(0), _period_us(0), _armed(false)
+{
+}
+
+LowPowerTimeout::~LowPowerTimeout()
+{
+    detach();
+}
+
+void LowPowerTimeout::attach_us(Callback<void()> func, us_timestamp_t us)
+{
+    detach();
+    _func = func;
+    _deadline_us = now_us + us;
+    _period_us = 0;
+    _armed = true;
+    timeout_list.push_back(this);
+}
+
+void LowPowerTimeout::detach(void)
+{
+    _armed = false;
+    timeout_list.erase(std::remove(timeout_list.begin(), timeout_list.end(), this), timeout_list.end());
+}
+
+void LowPowerTicker::attach_us(Callback<void()> func, us_timestamp_t us)
+{
+    LowPowerTimeout::attach_us(func, us);
+    _period_us = us;
+}
+
+}  // namespace mbed
+
+void sim_reset(void)
+{
+    now_us = 0;
+    pdwu_pending = false;
+    timeout_list.clear();
+    memset(&sim_stats, 0x00, sizeof (sim_stats));
+    wakeup_eventflags.clear();
+    wakeup_eventflags._set_count = 0;
+}
+
+us_timestamp_t sim_now_us(void)
+{
+    return now_us;
+}
+
+void sim_run_until(us_timestamp_t end_us)
+{
+    while (true) {
+        LowPowerTimeout *next = NULL;
+        for (LowPowerTimeout *timeout : timeout_list) {
+            if (next == NULL || timeout->_deadline_us < next->_deadline_us) {
+                next = timeout;
+            }
+        }
+        if (next == NULL || next->_deadline_us > end_us) {
+            break;
+        }
+
+        now_us = next->_deadline_us;
+        Callback<void()> func = next->_func;
+        if (next->_period_us) {
+            next->_deadline_us += next->_period_us;
+        } else {
+            next->detach();
+        }
+
+        /* lp_ticker interrupt */
+        struct Thunk {
+            static void run(Callback<void()> *func)
+            {
+                (*func)();
+            }
+        };
+        static Callback<void()> *cur_func;
+        cur_func = &func;
+        sim_wakeup_irq([]() { Thunk::run(cur_func); });
+    }
+
+    now_us = end_us;
+}
+
+void sim_wakeup_irq(void (*handler)(void))
+{
+    uint32_t set_count = wakeup_eventflags._set_count;
+
+    sim_stats.wakeups ++;
+
+    /* Source interrupt handler runs first, with PWRWU interrupt pending */
+    pdwu_pending = true;
+    handler();
+    pdwu_pending = false;
+
+    /* PWRWU_IRQHandler */
+    wakeup_notify_pdwu();
+
+    if (wakeup_eventflags._set_count != set_count) {
+        sim_stats.thread_wakeups ++;
+    }
+}
+
+bool sim_pin_edge(PinName pin, bool rise)
+{
+    for (InterruptIn *interrupt_in : interrupt_in_list()) {
+        if (interrupt_in->_pin != pin) {
+            continue;
+        }
+
+        Callback<void()> &func = rise ? interrupt_in->_rise : interrupt_in->_fall;
+        if (! interrupt_in->_irq_enabled || ! func) {
+            return false;
+        }
+
+        /* GPIO interrupt */
+        static Callback<void()> *cur_func;
+        cur_func = &func;
+        sim_wakeup_irq([]() { (*cur_func)(); });
+        return true;
+    }
+
+    return false;
+}
+
+void sim_busy_us(uint32_t us)
+{
+    sim_stats.busy_us += us;
+}
+
+void sim_set_adc(uint16_t (*waveform)(us_timestamp_t now_us))
+{
+    adc_waveform = waveform;
+}
+
+void sim_check(bool ok, const char *expr, const char *file, int line)
+{
+    if (! ok) {
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+        fail_count ++;
+    }
+}
+
+int sim_result(void)
+{
+    printf("%s\n", fail_count ? "FAIL" : "PASS");
+    return fail_count ? 1 : 0;
+}
@@ -0,0 +1,45 @@
+#ifndef __HOST_SIM_H__
+#define __HOST_SIM_H__
+
+#include "mbed.h"
+
+/* Host simulator of lp_ticker time and power-down wake-ups
+ *
+ * Simulated time only advances through sim_run_until(). Each expiring LowPowerTimeout/LowPowerTicker counts
+ * as one wake-up from power-down: its callback runs with PWRWU interrupt pending, as source interrupt
+ * handlers do on target, and then wakeup_notify_pdwu() runs as PWRWU_IRQHandler does.
+ */
+
+struct SimStats {
+    /* Wake-ups from power-down */
+    uint32_t    wakeups;
+    /* Wake-ups which woke up a thread, i.e. set wakeup_eventflags */
+    uint32_t    thread_wakeups;
+    /* CPU busy time accounted through sim_busy_us() */
+    uint64_t    busy_us;
+};
+
+extern SimStats sim_stats;
+
+/* Reset time, timers and statistics */
+void sim_reset(void);
+us_timestamp_t sim_now_us(void);
+/* Run expiring timers in time order until time reaches end_us */
+void sim_run_until(us_timestamp_t end_us);
+/* Run one interrupt handler as source of power-down wake-up at current time */
+void sim_wakeup_irq(void (*handler)(void));
+/* Drive edge on InterruptIn pin at current time. Return true if its interrupt is enabled and so it runs as
+ * source of power-down wake-up. */
+bool sim_pin_edge(PinName pin, bool rise);
+/* Account CPU busy time */
+void sim_busy_us(uint32_t us);
+
+/* ADC stand-in: analogin_read_u16() returns waveform(time) */
+void sim_set_adc(uint16_t (*waveform)(us_timestamp_t now_us));
+
+/* Check helper. Failed checks are counted and make the test fail. */
+#define SIM_CHECK(expr)     sim_check((expr), #expr, __FILE__, __LINE__)
+void sim_check(bool ok, const char *expr, const char *file, int line);
+int sim_result(void);
+
+#endif  // __HOST_SIM_H__
@@ -0,0 +1,14 @@
+#ifndef __HOST_ANALOGIN_API_H__
+#define __HOST_ANALOGIN_API_H__
+
+#include "mbed.h"
+
+typedef struct {
+    PinName     pin;
+} analogin_t;
+
+void analogin_init(analogin_t *obj, PinName pin);
+/* ADC stand-in: sample from the waveform installed by sim_set_adc() */
+uint16_t analogin_read_u16(analogin_t *obj);
+
+#endif  // __HOST_ANALOGIN_API_H__
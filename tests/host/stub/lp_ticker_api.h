@@ -0,0 +1,12 @@
+#ifndef __HOST_LP_TICKER_API_H__
+#define __HOST_LP_TICKER_API_H__
+
+#include "mbed.h"
+
+struct ticker_data_t;
+
+const ticker_data_t *get_lp_ticker_data(void);
+/* Simulated time */
+us_timestamp_t ticker_read_us(const ticker_data_t *ticker);
+
+#endif  // __HOST_LP_TICKER_API_H__
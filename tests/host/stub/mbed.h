@@ -0,0 +1,346 @@
+#ifndef __HOST_MBED_H__
+#define __HOST_MBED_H__
+
+/* Host stand-in for the subset of Mbed OS and Nuvoton BSP used by the host-testable modules
+ *
+ * Time, lp_ticker timeouts and interrupt context are simulated by sim.cpp. Critical sections are no-op
+ * because the simulation is single-threaded.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <functional>
+#include <utility>
+
+/* Target under simulation */
+#define TARGET_M480                 1
+#define TARGET_NUMAKER_PFM_M487     1
+
+/* Application configuration defaults, as in mbed_app.json5. Tests override them per executable. */
+#ifndef MBED_CONF_APP_ISR_ONLY_WAKEUP_SOURCES
+#define MBED_CONF_APP_ISR_ONLY_WAKEUP_SOURCES   0
+#endif
+#ifndef MBED_CONF_APP_SENSOR_BATCH_ENABLE
+#define MBED_CONF_APP_SENSOR_BATCH_ENABLE       1
+#endif
+#ifndef MBED_CONF_APP_SENSOR_BATCH_SIZE
+#define MBED_CONF_APP_SENSOR_BATCH_SIZE         16
+#endif
+#ifndef MBED_CONF_APP_SENSOR_SAMPLE_PERIOD_MS
+#define MBED_CONF_APP_SENSOR_SAMPLE_PERIOD_MS   100
+#endif
+#ifndef MBED_CONF_APP_SENSOR_THRESHOLD
+#define MBED_CONF_APP_SENSOR_THRESHOLD          0xFFFF
+#endif
+#ifndef MBED_CONF_APP_STORM_RATE
+#define MBED_CONF_APP_STORM_RATE                20
+#endif
+#ifndef MBED_CONF_APP_STORM_BURST
+#define MBED_CONF_APP_STORM_BURST               40
+#endif
+#ifndef MBED_CONF_APP_STORM_BACKOFF_MIN_MS
+#define MBED_CONF_APP_STORM_BACKOFF_MIN_MS      100
+#endif
+#ifndef MBED_CONF_APP_STORM_BACKOFF_MAX_MS
+#define MBED_CONF_APP_STORM_BACKOFF_MAX_MS      10000
+#endif
+#ifndef MBED_CONF_APP_TRACE_ENABLE
+#define MBED_CONF_APP_TRACE_ENABLE              0
+#endif
+#ifndef MBED_CONF_APP_TRACE_BUFFER_SIZE
+#define MBED_CONF_APP_TRACE_BUFFER_SIZE         256
+#endif
+#ifndef MBED_CONF_APP_WAKE_COROUTINE
+#define MBED_CONF_APP_WAKE_COROUTINE            0
+#endif
+#ifndef MBED_CONF_APP_WAKE_CORO_FRAMES
+#define MBED_CONF_APP_WAKE_CORO_FRAMES          4
+#endif
+#ifndef MBED_CONF_APP_WAKE_CORO_FRAME_SIZE
+#define MBED_CONF_APP_WAKE_CORO_FRAME_SIZE      256
+#endif
+#ifndef MBED_CONF_APP_WAKE_CORO_STACK_SIZE
+#define MBED_CONF_APP_WAKE_CORO_STACK_SIZE      2048
+#endif
+
+#define MBED_ASSERT(expr)           assert(expr)
+
+typedef uint64_t us_timestamp_t;
+typedef int32_t osStatus_t;
+
+#define osOK                        0
+#define osWaitForever               0xFFFFFFFFU
+#define osFlagsError                0x80000000U
+#define osFlagsErrorTimeout         0xFFFFFFFEU
+
+enum osPriority_t {
+    osPriorityNormal                = 24,
+};
+
+enum PinName {
+    A0,
+    SW2,
+    SW3,
+    NC                              = -1,
+};
+
+/* Atomics and critical section */
+void core_util_critical_section_enter(void);
+void core_util_critical_section_exit(void);
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *ptr)
+{
+    return *ptr;
+}
+
+inline uint32_t core_util_atomic_fetch_or_u32(volatile uint32_t *ptr, uint32_t arg)
+{
+    uint32_t old = *ptr;
+    *ptr = old | arg;
+    return old;
+}
+
+inline uint32_t core_util_atomic_fetch_and_u32(volatile uint32_t *ptr, uint32_t arg)
+{
+    uint32_t old = *ptr;
+    *ptr = old & arg;
+    return old;
+}
+
+inline void *core_util_atomic_exchange_ptr(void *volatile *ptr, void *desired)
+{
+    void *old = *ptr;
+    *ptr = desired;
+    return old;
+}
+
+/* Nuvoton BSP */
+#define __NVIC_PRIO_BITS            4
+
+#define CLK_PMUCTL_PDMSEL_PD        0x0UL
+#define CLK_PMUCTL_PDMSEL_LLPD      0x1UL
+#define CLK_PMUCTL_PDMSEL_FWPD      0x2UL
+#define CLK_PMUCTL_PDMSEL_SPD0      0x4UL
+#define CLK_PMUCTL_PDMSEL_SPD1      0x5UL
+#define CLK_PMUCTL_PDMSEL_DPD       0x6UL
+
+/* PMU status. Writing CLRWK clears wake-up flags on target. Here it is just stored. */
+typedef struct {
+    volatile uint32_t   PMUSTS;
+} CLK_T;
+
+extern CLK_T sim_clk;
+#define CLK                         (&sim_clk)
+
+#define CLK_PMUSTS_RTCWK_Msk        (1UL << 2)
+#define CLK_PMUSTS_CLRWK_Msk        (1UL << 31)
+
+void SYS_UnlockReg(void);
+void SYS_LockReg(void);
+void CLK_SetPowerDownMode(uint32_t pdmsel);
+
+namespace mbed {
+
+template <typename F>
+class Callback;
+
+template <typename R, typename... A>
+class Callback<R(A...)> {
+public:
+    Callback()
+    {
+    }
+
+    Callback(R (*func)(A...)) : _func(func)
+    {
+    }
+
+    template <typename T, typename U>
+    Callback(R (*func)(T *, A...), U *arg) : _func([func, arg](A... a) { return func(arg, a...); })
+    {
+    }
+
+    template <typename T, typename U>
+    Callback(U *obj, R (T::*method)(A...)) : _func([obj, method](A... a) { return (obj->*method)(a...); })
+    {
+    }
+
+    R operator()(A... a) const
+    {
+        return _func(a...);
+    }
+
+    explicit operator bool() const
+    {
+        return (bool) _func;
+    }
+
+private:
+    std::function<R(A...)>  _func;
+};
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*func)(A...))
+{
+    return Callback<R(A...)>(func);
+}
+
+template <typename R, typename T, typename U, typename... A>
+Callback<R(A...)> callback(R (*func)(T *, A...), U *arg)
+{
+    return Callback<R(A...)>(func, arg);
+}
+
+template <typename R, typename T, typename U, typename... A>
+Callback<R(A...)> callback(U *obj, R (T::*method)(A...))
+{
+    return Callback<R(A...)>(obj, method);
+}
+
+class CriticalSectionLock {
+public:
+    CriticalSectionLock()
+    {
+        core_util_critical_section_enter();
+    }
+
+    ~CriticalSectionLock()
+    {
+        core_util_critical_section_exit();
+    }
+};
+
+/* GPIO edge interrupt, triggered by sim_pin_edge() */
+class InterruptIn {
+public:
+    InterruptIn(PinName pin);
+    ~InterruptIn();
+
+    void fall(Callback<void()> func)
+    {
+        _fall = func;
+    }
+
+    void rise(Callback<void()> func)
+    {
+        _rise = func;
+    }
+
+    void enable_irq(void)
+    {
+        _irq_enabled = true;
+    }
+
+    void disable_irq(void)
+    {
+        _irq_enabled = false;
+    }
+
+    /* Simulation */
+    PinName             _pin;
+    Callback<void()>    _fall;
+    Callback<void()>    _rise;
+    bool                _irq_enabled;
+};
+
+/* lp_ticker timeout, scheduled on simulated time */
+class LowPowerTimeout {
+public:
+    LowPowerTimeout();
+    ~LowPowerTimeout();
+
+    void attach_us(Callback<void()> func, us_timestamp_t us);
+    void detach(void);
+
+    /* Simulation */
+    Callback<void()>    _func;
+    us_timestamp_t      _deadline_us;
+    us_timestamp_t      _period_us;
+    bool                _armed;
+};
+
+class LowPowerTicker : public LowPowerTimeout {
+public:
+    void attach_us(Callback<void()> func, us_timestamp_t us);
+};
+
+}  // namespace mbed
+
+namespace rtos {
+
+class EventFlags {
+public:
+    EventFlags() : _flags(0), _set_count(0)
+    {
+    }
+
+    uint32_t set(uint32_t flags)
+    {
+        _flags |= flags;
+        _set_count ++;
+        return _flags;
+    }
+
+    uint32_t get(void) const
+    {
+        return _flags;
+    }
+
+    uint32_t clear(uint32_t flags = 0x7FFFFFFF)
+    {
+        uint32_t old = _flags;
+        _flags &= ~flags;
+        return old;
+    }
+
+    /* Simulation: never blocks, returns and clears flags already set */
+    uint32_t wait_any(uint32_t flags, uint32_t millisec = osWaitForever, bool clear_ = true)
+    {
+        (void) millisec;
+        uint32_t got = _flags & flags;
+        if (clear_) {
+            _flags &= ~got;
+        }
+        return got ? got : osFlagsErrorTimeout;
+    }
+
+    /* Simulation: number of set() calls, i.e. thread wake-ups */
+    uint32_t    _flags;
+    uint32_t    _set_count;
+};
+
+class Thread {
+public:
+    enum State {
+        Deleted,
+    };
+
+    Thread(osPriority_t priority = osPriorityNormal, uint32_t stack_size = 4096) : _stack_size(stack_size)
+    {
+        (void) priority;
+    }
+
+    osStatus_t start(mbed::Callback<void()> task)
+    {
+        (void) task;
+        return osOK;
+    }
+
+    uint32_t stack_size(void) const
+    {
+        return _stack_size;
+    }
+
+private:
+    uint32_t    _stack_size;
+};
+
+}  // namespace rtos
+
+using namespace mbed;
+using namespace rtos;
+
+#endif  // __HOST_MBED_H__
@@ -0,0 +1,16 @@
+#ifndef __HOST_RTX_OS_H__
+#define __HOST_RTX_OS_H__
+
+struct osRtxThreadList_t {
+    void *      thread_list;
+};
+
+struct osRtxInfo_t {
+    struct {
+        osRtxThreadList_t   ready;
+    } thread;
+};
+
+extern osRtxInfo_t osRtxInfo;
+
+#endif  // __HOST_RTX_OS_H__
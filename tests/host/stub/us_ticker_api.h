@@ -0,0 +1,8 @@
+#ifndef __HOST_US_TICKER_API_H__
+#define __HOST_US_TICKER_API_H__
+
+#include "lp_ticker_api.h"
+
+const ticker_data_t *get_us_ticker_data(void);
+
+#endif  // __HOST_US_TICKER_API_H__
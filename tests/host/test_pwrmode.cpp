@@ -0,0 +1,156 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "pwrmode.h"
+#include "sim.h"
+
+/* Power-down mode selection on M480/M261 table
+ *
+ * pwrmode_select() is checked against a reference for every combination of wake-up sources, reset policy,
+ * SRAM retention and latency tolerance. The reachable set of modes is checked explicitly for the default
+ * configuration, and the restore hook against simulated PMU status at boot.
+ */
+
+/* Wake-up sources able to wake up from some power-down mode */
+#define NU_WAKEUP_ALL       (EventFlag_Wakeup_All & ~EventFlag_Wakeup_UnID)
+
+/* Mode indices in pwrmode.cpp */
+enum {
+    Mode_FWPD,
+    Mode_NPD,
+    Mode_LLPD,
+    Mode_SPD0,
+    Mode_SPD1,
+    Mode_DPD,
+    Mode_Num,
+};
+
+/* Expected table, spelled out independently of pwrmode.cpp */
+static const struct {
+    const char *    name;
+    uint32_t        wakeup_sources;
+    uint32_t        exit_latency_us;
+    bool            resumes;
+    uint32_t        retained_sram;
+} expect_arr[Mode_Num] = {
+    {"FWPD", NU_WAKEUP_ALL, 300, true, UINT32_MAX},
+    {"NPD", NU_WAKEUP_ALL, 800, true, UINT32_MAX},
+    {"LLPD", NU_WAKEUP_ALL, 1200, true, UINT32_MAX},
+    {"SPD0", EventFlag_Wakeup_RTC_Alarm, 5000, false, 16 * 1024},
+    {"SPD1", EventFlag_Wakeup_RTC_Alarm, 5000, false, 0},
+    {"DPD", EventFlag_Wakeup_RTC_Alarm, 8000, false, 0},
+};
+
+static const uint32_t latency_arr[] = {0, 299, 300, 800, 1199, 1200, 4999, 5000, 8000, UINT32_MAX};
+static const uint32_t retain_arr[] = {0, 1, 16 * 1024, 16 * 1024 + 1};
+
+static uint32_t restore_count = 0;
+
+static int expect_select(uint32_t sources, uint32_t max_latency_us, bool allow_reset, uint32_t retain_bytes)
+{
+    for (int mode = Mode_Num - 1; mode >= 0; mode --) {
+        if ((sources & ~expect_arr[mode].wakeup_sources) == 0 &&
+            (expect_arr[mode].resumes || (allow_reset && expect_arr[mode].retained_sram >= retain_bytes)) &&
+            expect_arr[mode].exit_latency_us <= max_latency_us) {
+            return mode;
+        }
+    }
+
+    return -1;
+}
+
+static void save_hook(void)
+{
+}
+
+static void restore_hook(void)
+{
+    restore_count ++;
+}
+
+int main(void)
+{
+    sim_reset();
+
+    SIM_CHECK(pwrmode_num() == Mode_Num);
+    for (int mode = 0; mode < Mode_Num; mode ++) {
+        SIM_CHECK(strcmp(pwrmode_desc(mode)->name, expect_arr[mode].name) == 0);
+    }
+    SIM_CHECK(pwrmode_min_exit_latency_us() == 300);
+
+    /* Default: lp_ticker in use and reset not allowed. Only modes which resume are reachable. */
+    uint32_t resuming = (1 << Mode_FWPD) | (1 << Mode_NPD) | (1 << Mode_LLPD);
+    SIM_CHECK(pwrmode_reachable(true, 0) == resuming);
+    SIM_CHECK(pwrmode_reachable(false, 0) == resuming);
+
+    /* Reset allowed but lp_ticker still in use: standby/deep power-down still unreachable */
+    pwrmode_allow_reset(true, &save_hook, &restore_hook);
+    SIM_CHECK(pwrmode_reachable(true, 0) == resuming);
+    pwrmode_allow_reset(false, NULL, NULL);
+
+    /* Every combination of wake-up sources, reset policy, SRAM retention and latency */
+    uint32_t combos = 0;
+    uint32_t reached = 0;
+    for (uint32_t sources = 0; sources <= NU_WAKEUP_ALL; sources ++) {
+        if (sources & ~NU_WAKEUP_ALL) {
+            continue;
+        }
+
+        pwrmode_disable_wakeup_source(NU_WAKEUP_ALL);
+        pwrmode_enable_wakeup_source(sources);
+
+        for (int policy = 0; policy < 4; policy ++) {
+            bool reset_allowed = policy & 1;
+            bool allow_reset = policy & 2;
+            pwrmode_allow_reset(reset_allowed, reset_allowed ? &save_hook : NULL,
+                                reset_allowed ? &restore_hook : NULL);
+
+            for (uint32_t retain_bytes : retain_arr) {
+                for (uint32_t max_latency_us : latency_arr) {
+                    int mode = pwrmode_select(max_latency_us, allow_reset, retain_bytes);
+                    int expect = expect_select(sources, max_latency_us, allow_reset && reset_allowed, retain_bytes);
+                    if (mode != expect) {
+                        printf("sources 0x%03lx, reset %d/%d, retain %lu, latency %lu: got %d, expect %d\n",
+                               (unsigned long) sources, reset_allowed, allow_reset, (unsigned long) retain_bytes,
+                               (unsigned long) max_latency_us, mode, expect);
+                    }
+                    SIM_CHECK(mode == expect);
+                    if (mode >= 0) {
+                        SIM_CHECK((pwrmode_reachable(allow_reset, retain_bytes) & (1 << mode)) != 0);
+                        reached |= 1 << mode;
+                    }
+                    combos ++;
+                }
+            }
+        }
+    }
+
+    printf("Power-down mode selection: %lu combinations checked\n", (unsigned long) combos);
+
+    /* All modes get selected for some combination */
+    SIM_CHECK(reached == ((1 << Mode_Num) - 1));
+
+    /* Only with lp_ticker disabled and reset allowed are standby/deep power-down reachable. SPD0 only when
+     * SRAM retention is needed and fits. */
+    pwrmode_disable_wakeup_source(NU_WAKEUP_ALL);
+    pwrmode_enable_wakeup_source(EventFlag_Wakeup_RTC_Alarm);
+    pwrmode_allow_reset(true, &save_hook, &restore_hook);
+    SIM_CHECK(pwrmode_select(UINT32_MAX, true, 0) == Mode_DPD);
+    SIM_CHECK(pwrmode_select(UINT32_MAX, true, 1024) == Mode_SPD0);
+    SIM_CHECK(pwrmode_select(UINT32_MAX, true, 32 * 1024) == Mode_LLPD);
+    SIM_CHECK(pwrmode_select(UINT32_MAX, false, 0) == Mode_LLPD);
+
+    /* Cold boot: no PMU wake-up flag, nothing to restore */
+    CLK->PMUSTS = 0;
+    SIM_CHECK(! pwrmode_boot());
+    SIM_CHECK(restore_count == 0);
+
+    /* Boot on RTC wake-up from standby: restore once and clear flags */
+    CLK->PMUSTS = CLK_PMUSTS_RTCWK_Msk;
+    SIM_CHECK(pwrmode_boot());
+    SIM_CHECK(restore_count == 1);
+    SIM_CHECK((CLK->PMUSTS & ~CLK_PMUSTS_CLRWK_Msk) == 0);
+    SIM_CHECK(! pwrmode_boot());
+    SIM_CHECK(restore_count == 1);
+
+    return sim_result();
+}
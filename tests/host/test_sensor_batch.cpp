@@ -0,0 +1,86 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "sim.h"
+
+/* Sensor batching on simulated lp_ticker and ADC
+ *
+ * Each sample wakes up from power-down. Only full batches (or threshold crossings) must wake up a thread
+ * and run the main loop. Built twice: with threshold disabled (0xFFFF) and with threshold 0x8000.
+ */
+
+#define NU_SAMPLE_NUM           100
+#define NU_RUN_US               ((us_timestamp_t) NU_SAMPLE_NUM * MBED_CONF_APP_SENSOR_SAMPLE_PERIOD_MS * 1000)
+
+#if MBED_CONF_APP_SENSOR_THRESHOLD == 0xFFFF
+/* Full scale, which crosses any threshold but the disabled one */
+static uint16_t adc_full_scale(us_timestamp_t now_us)
+{
+    (void) now_us;
+    return 0xFFFF;
+}
+#else
+/* Low level with spikes at 1.1 s (11th sample) and 6.0 s (60th), and high level sustained from 3.0 s to
+ * 4.9 s (30th to 49th). Threshold is crossed upwards three times. */
+static uint16_t adc_pulses(us_timestamp_t now_us)
+{
+    if (now_us == 1100000 || now_us == 6000000 || (now_us >= 3000000 && now_us < 5000000)) {
+        return 0x9000;
+    }
+
+    return 0x1000;
+}
+#endif
+
+int main(void)
+{
+    uint16_t buf[MBED_CONF_APP_SENSOR_BATCH_SIZE];
+
+    sim_reset();
+#if MBED_CONF_APP_SENSOR_THRESHOLD == 0xFFFF
+    sim_set_adc(&adc_full_scale);
+#else
+    sim_set_adc(&adc_pulses);
+#endif
+    config_sensor_batch_wakeup();
+
+    /* Before the first batch is full, only the spike may notify */
+    sim_run_until(1100000);
+#if MBED_CONF_APP_SENSOR_THRESHOLD == 0xFFFF
+    SIM_CHECK(sim_stats.thread_wakeups == 0);
+#else
+    SIM_CHECK(sim_stats.thread_wakeups == 1);
+    SIM_CHECK(sensor_batch_fetch(buf, MBED_CONF_APP_SENSOR_BATCH_SIZE) == 11);
+#endif
+
+#if MBED_CONF_APP_SENSOR_THRESHOLD != 0xFFFF
+    /* Sustained high level notifies once on crossing at 3.0 s, then only on full batch at 4.6 s */
+    sim_run_until(5000000);
+    SIM_CHECK(sim_stats.thread_wakeups == 4);
+    SIM_CHECK(sensor_batch_fetch(buf, MBED_CONF_APP_SENSOR_BATCH_SIZE) == MBED_CONF_APP_SENSOR_BATCH_SIZE);
+#endif
+
+    sim_run_until(NU_RUN_US);
+
+    uint32_t batch_num = NU_SAMPLE_NUM / MBED_CONF_APP_SENSOR_BATCH_SIZE;
+#if MBED_CONF_APP_SENSOR_THRESHOLD != 0xFFFF
+    /* Batches closed at samples 11 (spike), 27 (full), 30 (rising crossing), 46 (full), 60 (spike after
+     * re-arm), 76 and 92 (full) */
+    batch_num = 7;
+#endif
+
+    printf("Sensor batch: %u samples, batch %u, threshold 0x%04X\n", NU_SAMPLE_NUM,
+           MBED_CONF_APP_SENSOR_BATCH_SIZE, MBED_CONF_APP_SENSOR_THRESHOLD);
+    printf("  power-down wake-ups:   %lu\n", (unsigned long) sim_stats.wakeups);
+    printf("  thread wake-ups:       %lu (%lu without batching)\n", (unsigned long) sim_stats.thread_wakeups,
+           (unsigned long) sim_stats.wakeups);
+
+    SIM_CHECK(sim_stats.wakeups == NU_SAMPLE_NUM);
+    SIM_CHECK(sim_stats.thread_wakeups == batch_num);
+    SIM_CHECK(wakeup_eventflags.get() == (EventFlag_Wakeup_SensorBatch | EventFlag_Wakeup_UnID));
+
+    size_t n_samples = sensor_batch_fetch(buf, MBED_CONF_APP_SENSOR_BATCH_SIZE);
+    SIM_CHECK(n_samples == MBED_CONF_APP_SENSOR_BATCH_SIZE);
+    SIM_CHECK(sensor_batch_fetch(buf, MBED_CONF_APP_SENSOR_BATCH_SIZE) == 0);
+
+    return sim_result();
+}
@@ -0,0 +1,217 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "sim.h"
+
+/* Wake-up storm rate sweep
+ *
+ * One source hands its events off to a thread, like UART CTS/I2C: its interrupt handler calls
+ * wakeup_accept() and wakes up the thread only for accepted events, and its deliver hook runs the thread once
+ * for events held back. Event rate is swept and CPU duty cycle is estimated from per-wake-up and
+ * per-thread-run costs, with and without masking wake-up enable on storm.
+ *
+ * Chattering button is swept too, through the gesture engine: its edges are throttled, and the main loop must
+ * only run for recognized gestures.
+ */
+
+#define NU_SOURCE                   EventFlag_Wakeup_UART_CTS
+
+/* Estimated costs: power-down wake-up with interrupt handler, and thread run with context switches */
+#define NU_WAKEUP_COST_US           30
+#define NU_THREAD_COST_US           400
+
+#define NU_SWEEP_US                 (10 * 1000 * 1000ULL)
+/* Quiet time between sweeps, so that the source gets re-enabled and backoff starts over from min */
+#define NU_QUIET_US                 (3 * MBED_CONF_APP_STORM_BACKOFF_MAX_MS * 1000ULL)
+
+static bool use_mask;
+static bool masked;
+/* Interrupt handler runs */
+static uint32_t irq_runs;
+/* Thread runs for accepted events */
+static uint32_t thread_runs;
+/* Thread runs for held-back events on re-enable, and events they deliver */
+static uint32_t deliver_runs;
+static uint32_t deliver_events;
+
+static void source_mask(uint32_t eventflag, bool masked_)
+{
+    (void) eventflag;
+
+    if (use_mask) {
+        masked = masked_;
+    }
+}
+
+/* Held-back events were dropped in interrupt handler. Thread runs once for them. */
+static bool source_deliver(uint32_t eventflag, uint32_t pending)
+{
+    deliver_runs ++;
+    deliver_events += pending;
+    sim_busy_us(NU_THREAD_COST_US);
+    wakeup_notify_deferred(eventflag);
+    return true;
+}
+
+/* Source interrupt handler */
+static void source_irq(void)
+{
+    irq_runs ++;
+    sim_busy_us(NU_WAKEUP_COST_US);
+
+    if (wakeup_accept(NU_SOURCE)) {
+        /* Thread runs and notifies main loop */
+        thread_runs ++;
+        sim_busy_us(NU_THREAD_COST_US);
+        wakeup_notify_deferred(NU_SOURCE);
+    }
+}
+
+static void sweep(uint32_t rate_hz)
+{
+    us_timestamp_t start_us = sim_now_us();
+    us_timestamp_t period_us = 1000000 / rate_hz;
+
+    memset(&sim_stats, 0x00, sizeof (sim_stats));
+    irq_runs = 0;
+    thread_runs = 0;
+    deliver_runs = 0;
+    deliver_events = 0;
+
+    for (us_timestamp_t t = start_us + period_us; t <= start_us + NU_SWEEP_US; t += period_us) {
+        sim_run_until(t);
+        /* Masked wake-up enable: event doesn't wake up CPU */
+        if (! masked) {
+            sim_wakeup_irq(&source_irq);
+        }
+    }
+    sim_run_until(start_us + NU_SWEEP_US);
+
+    uint32_t event_num = NU_SWEEP_US / period_us;
+    uint32_t duty_permille = sim_stats.busy_us * 1000 / NU_SWEEP_US;
+    /* Unthrottled, every event would wake up CPU and run thread */
+    uint64_t raw_busy_us = (uint64_t) event_num * (NU_WAKEUP_COST_US + NU_THREAD_COST_US);
+    uint32_t raw_permille = raw_busy_us * 1000 / NU_SWEEP_US;
+
+    printf("  %5lu Hz: %6lu events, %6lu wake-ups, %4lu+%lu thread runs, %4lu main loop runs, duty %3lu.%lu%% "
+           "(%lu.%lu%% unthrottled)\n", (unsigned long) rate_hz, (unsigned long) event_num,
+           (unsigned long) sim_stats.wakeups, (unsigned long) thread_runs, (unsigned long) deliver_runs,
+           (unsigned long) sim_stats.thread_wakeups,
+           (unsigned long) duty_permille / 10, (unsigned long) duty_permille % 10,
+           (unsigned long) raw_permille / 10, (unsigned long) raw_permille % 10);
+
+    /* Thread runs are bounded by the token bucket: burst plus rate over the sweep, whatever the event rate */
+    uint32_t max_thread_runs = MBED_CONF_APP_STORM_BURST + MBED_CONF_APP_STORM_RATE * (NU_SWEEP_US / 1000000);
+    SIM_CHECK(thread_runs <= max_thread_runs);
+    SIM_CHECK(thread_runs <= event_num);
+    /* Held-back events are delivered once per re-enable */
+    uint32_t max_reenables = NU_SWEEP_US / (MBED_CONF_APP_STORM_BACKOFF_MIN_MS * 1000);
+    SIM_CHECK(deliver_runs <= max_reenables);
+    /* Held-back events don't run main loop. It runs per accepted event and per storm/re-enable at most. */
+    SIM_CHECK(sim_stats.thread_wakeups <= thread_runs + 2 * max_reenables);
+
+    if (use_mask) {
+        /* Masked: thread runs and wake-ups both bounded, so duty cycle is bounded too */
+        uint64_t max_busy_us = (uint64_t) max_thread_runs * (NU_WAKEUP_COST_US + NU_THREAD_COST_US) +
+                               (uint64_t) max_reenables * (2 * NU_WAKEUP_COST_US + NU_THREAD_COST_US);
+        SIM_CHECK(sim_stats.busy_us <= max_busy_us);
+    } else {
+        /* Software-only: every event still wakes up CPU, but only for the cheap interrupt handler */
+        SIM_CHECK(sim_stats.busy_us <= (uint64_t) event_num * NU_WAKEUP_COST_US +
+                                       (uint64_t) (max_thread_runs + max_reenables) * NU_THREAD_COST_US);
+    }
+
+    /* Quiet down and let the source get re-enabled for next sweep */
+    sim_run_until(sim_now_us() + NU_QUIET_US);
+    wakeup_storm_fetch();
+    wakeup_eventflags.clear();
+
+    /* Thread has run after re-enable for events held back, and no event is lost */
+    SIM_CHECK(thread_runs == irq_runs || deliver_runs > 0);
+    SIM_CHECK(thread_runs + deliver_events == irq_runs);
+}
+
+/* Main loop stand-in: button wake-up must come with a gesture */
+static uint32_t button_main_loop(void)
+{
+    uint32_t flags = wakeup_eventflags.get();
+    wakeup_eventflags.clear();
+
+    if (flags & EventFlag_Wakeup_Button1) {
+        SIM_CHECK(button_gesture_fetch(EventFlag_Wakeup_Button1) != ButtonGesture_None);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void sweep_button(uint32_t rate_hz)
+{
+    us_timestamp_t start_us = sim_now_us();
+    us_timestamp_t period_us = 1000000 / rate_hz;
+    uint32_t edge_irqs = 0;
+    uint32_t gestures = 0;
+    bool rise = false;
+
+    memset(&sim_stats, 0x00, sizeof (sim_stats));
+
+    /* Chattering: edges alternate between press (fall) and release (rise) */
+    for (us_timestamp_t t = start_us + period_us; t <= start_us + NU_SWEEP_US; t += period_us) {
+        sim_run_until(t);
+        gestures += button_main_loop();
+        if (sim_pin_edge(SW2, rise)) {
+            edge_irqs ++;
+            sim_busy_us(NU_WAKEUP_COST_US);
+        }
+        rise = ! rise;
+        gestures += button_main_loop();
+    }
+    sim_run_until(start_us + NU_SWEEP_US);
+    gestures += button_main_loop();
+
+    uint32_t event_num = NU_SWEEP_US / period_us;
+    printf("  %5lu Hz: %6lu edges, %6lu edge wake-ups, %4lu gestures, %4lu main loop runs\n",
+           (unsigned long) rate_hz, (unsigned long) event_num, (unsigned long) edge_irqs,
+           (unsigned long) gestures, (unsigned long) sim_stats.thread_wakeups);
+
+    /* Edges are throttled: masked button doesn't wake up CPU beyond token bucket and one edge per storm */
+    uint32_t max_edge_irqs = MBED_CONF_APP_STORM_BURST + MBED_CONF_APP_STORM_RATE * (NU_SWEEP_US / 1000000) +
+                             NU_SWEEP_US / (MBED_CONF_APP_STORM_BACKOFF_MIN_MS * 1000);
+    SIM_CHECK(edge_irqs <= max_edge_irqs);
+    /* A gesture takes two edges at least */
+    SIM_CHECK(gestures <= edge_irqs / 2 + 1);
+
+    sim_run_until(sim_now_us() + NU_QUIET_US);
+    button_main_loop();
+    wakeup_storm_fetch();
+    wakeup_eventflags.clear();
+}
+
+int main(void)
+{
+    static const uint32_t rate_arr[] = {1, 10, 100, 1000, 10000};
+
+    sim_reset();
+    wakeup_storm_set_mask_hook(NU_SOURCE, &source_mask);
+    wakeup_storm_set_deliver_hook(NU_SOURCE, &source_deliver);
+
+    for (int mask = 1; mask >= 0; mask --) {
+        use_mask = mask;
+        printf("Storm rate sweep, rate limit %u/s, burst %u, %s:\n", MBED_CONF_APP_STORM_RATE,
+               MBED_CONF_APP_STORM_BURST, use_mask ? "wake-up enable masked" : "software only");
+
+        for (uint32_t rate_hz : rate_arr) {
+            /* Fresh token bucket per sweep */
+            wakeup_storm_set_limit(NU_SOURCE, MBED_CONF_APP_STORM_RATE, MBED_CONF_APP_STORM_BURST);
+            sweep(rate_hz);
+        }
+    }
+
+    config_button_wakeup();
+    printf("Storm rate sweep, chattering button:\n");
+    for (uint32_t rate_hz : rate_arr) {
+        wakeup_storm_set_limit(EventFlag_Wakeup_Button1, MBED_CONF_APP_STORM_RATE, MBED_CONF_APP_STORM_BURST);
+        sweep_button(rate_hz);
+    }
+
+    return sim_result();
+}
@@ -0,0 +1,96 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "trace.h"
+#include "sim.h"
+
+/* Timeline trace on simulated time
+ *
+ * Sensor sampling and button presses are traced by their interrupt handlers, and a main loop stand-in traces
+ * its runs. Timestamps come from simulated lp_ticker time, started shortly before 32-bit wrap-around. The
+ * dump is written to the file given as argument (stdout by default) for tools/trace2chrome.py to convert.
+ */
+
+#define NU_START_US             ((1ULL << 32) - 2 * 1000 * 1000)
+#define NU_RUN_US               (4 * 1000 * 1000)
+#define NU_STEP_US              (50 * 1000)
+
+/* Button1 presses (fall) and releases (rise): short click, then long press */
+struct ButtonEdge {
+    us_timestamp_t  offset_us;
+    bool            rise;
+};
+
+static const ButtonEdge button_edge_arr[] = {
+    {1000000, false},
+    {1100000, true},
+    {2000000, false},
+    {3000000, true},
+};
+
+static uint32_t main_loop_runs = 0;
+static uint32_t trace_dumps = 0;
+
+/* Main loop stand-in, with dump policy of main() */
+static void main_loop(void)
+{
+    uint32_t flags = wakeup_eventflags.get();
+    if (flags == 0) {
+        return;
+    }
+    wakeup_eventflags.clear();
+
+    TRACE_BEGIN(TraceEvent_Thread_Main);
+    main_loop_runs ++;
+
+    if (flags & EventFlag_Wakeup_SensorBatch) {
+        uint16_t buf[MBED_CONF_APP_SENSOR_BATCH_SIZE];
+        sensor_batch_fetch(buf, MBED_CONF_APP_SENSOR_BATCH_SIZE);
+    }
+    if (flags & EventFlag_Wakeup_Button1) {
+        SIM_CHECK(button_gesture_fetch(EventFlag_Wakeup_Button1) != ButtonGesture_None);
+    }
+    TRACE_END(TraceEvent_Thread_Main);
+
+    if (trace_pending() >= (MBED_CONF_APP_TRACE_BUFFER_SIZE / 2)) {
+        trace_dump();
+        trace_dumps ++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && freopen(argv[1], "w", stdout) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    sim_reset();
+    sim_run_until(NU_START_US);
+    config_sensor_batch_wakeup();
+    config_button_wakeup();
+
+    size_t edge_idx = 0;
+    for (us_timestamp_t t = NU_STEP_US; t <= NU_RUN_US; t += NU_STEP_US) {
+        sim_run_until(NU_START_US + t);
+        main_loop();
+
+        while (edge_idx < (sizeof (button_edge_arr) / sizeof (button_edge_arr[0])) &&
+               button_edge_arr[edge_idx].offset_us <= t) {
+            SIM_CHECK(sim_pin_edge(SW2, button_edge_arr[edge_idx].rise));
+            edge_idx ++;
+            main_loop();
+        }
+    }
+
+    trace_dump();
+    SIM_CHECK(trace_pending() == 0);
+
+    /* Each sample and button edge is traced, and the main loop runs per batch and gesture */
+    SIM_CHECK(main_loop_runs >= (NU_RUN_US / (MBED_CONF_APP_SENSOR_SAMPLE_PERIOD_MS * 1000)) /
+                                MBED_CONF_APP_SENSOR_BATCH_SIZE);
+    SIM_CHECK(trace_dumps > 0);
+
+    fprintf(stderr, "Trace: %lu main loop runs, %lu dumps\n", (unsigned long) main_loop_runs,
+            (unsigned long) trace_dumps);
+    return sim_result();
+}
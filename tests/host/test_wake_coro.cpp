@@ -0,0 +1,107 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "wake_coro.h"
+#include "sim.h"
+
+/* Coroutine scheduler on simulated time
+ *
+ * There is no scheduler thread on host. Each round is run by wake_coro_poll() after posting events or
+ * advancing time.
+ */
+
+static uint32_t rtc_resumes = 0;
+static uint32_t uart_resumes = 0;
+static uint32_t sleep_ticks = 0;
+
+static WakeTask rtc_task(void)
+{
+    while (true) {
+        co_await wake(Source::RtcAlarm);
+        rtc_resumes ++;
+    }
+}
+
+static WakeTask sleep_task(void)
+{
+    while (true) {
+        co_await sleep_for(10);
+        sleep_ticks ++;
+    }
+}
+
+/* Completes after one event, freeing its frame */
+static WakeTask uart_task(void)
+{
+    co_await wake(Source::UartCts);
+    uart_resumes ++;
+}
+
+static void rtc_irq(void)
+{
+    wake_coro_post(Source::RtcAlarm);
+}
+
+static void uart_irq(void)
+{
+    wake_coro_post(Source::UartCts);
+}
+
+int main(void)
+{
+    sim_reset();
+
+    wake_coro_spawn(&rtc_task);
+    wake_coro_spawn(&sleep_task);
+    wake_coro_poll();
+    SIM_CHECK(rtc_resumes == 0);
+    SIM_CHECK(sleep_ticks == 0);
+
+    /* Resume on event. Events posted meanwhile coalesce like a binary semaphore. */
+    sim_wakeup_irq(&rtc_irq);
+    wake_coro_poll();
+    SIM_CHECK(rtc_resumes == 1);
+    sim_wakeup_irq(&rtc_irq);
+    sim_wakeup_irq(&rtc_irq);
+    wake_coro_poll();
+    wake_coro_poll();
+    SIM_CHECK(rtc_resumes == 2);
+
+    /* sleep_for: one resume per 10 ms, backed by one lp_ticker timeout */
+    uint32_t wakeups = sim_stats.wakeups;
+    uint32_t thread_wakeups = sim_stats.thread_wakeups;
+    for (us_timestamp_t ms = 1; ms <= 100; ms ++) {
+        sim_run_until(ms * 1000);
+        wake_coro_poll();
+    }
+    SIM_CHECK(sleep_ticks == 10);
+    SIM_CHECK(sim_stats.wakeups - wakeups == 10);
+    /* Sleep timeouts resume scheduler thread only, never the main loop */
+    SIM_CHECK(sim_stats.thread_wakeups == thread_wakeups);
+
+    /* Frame pool: two frames left. The third spawn fails and never runs. */
+    wake_coro_spawn(&uart_task);
+    wake_coro_spawn(&uart_task);
+    wake_coro_spawn(&uart_task);
+    wake_coro_poll();
+    for (int i = 1; i <= 3; i ++) {
+        sim_wakeup_irq(&uart_irq);
+        wake_coro_poll();
+        SIM_CHECK(uart_resumes == (uint32_t) ((i <= 2) ? i : 2));
+    }
+
+    /* Completed coroutines have freed their frames */
+    wake_coro_spawn(&uart_task);
+    wake_coro_poll();
+    sim_wakeup_irq(&uart_irq);
+    wake_coro_poll();
+    SIM_CHECK(uart_resumes == 3);
+
+    /* Other coroutines are unaffected */
+    sim_run_until(sim_now_us() + 10000);
+    wake_coro_poll();
+    SIM_CHECK(sleep_ticks == 11);
+
+    wake_coro_dump_stats();
+
+    return sim_result();
+}
@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+#
+# Convert timeline trace dumped by trace_dump() to Chrome trace/Perfetto JSON
+#
+# Usage: trace2chrome.py <serial log> [output.json]
+#
+# Trace lines are picked out of the serial log, so the log needn't be cleaned first:
+#
+#   TRACE <timestamp in us> <B|E|i> <track> <event>
+#   TRACE_DROPPED <count>
+#
+# Open the output with chrome://tracing or https://ui.perfetto.dev.
+
+import json
+import sys
+
+# lp_ticker timestamp is 32-bit and wraps around
+TS_WRAP = 1 << 32
+
+
+def convert(lines):
+    events = []
+    tids = {}
+    ts_base = 0
+    ts_last = None
+
+    for line in lines:
+        fields = line.strip().split(None, 4)
+        if not fields:
+            continue
+
+        if fields[0] == 'TRACE_DROPPED' and len(fields) == 2:
+            events.append({'name': 'dropped %s' % fields[1], 'ph': 'i', 's': 'g', 'pid': 0, 'tid': 0,
+                           'ts': (ts_base + ts_last) if ts_last is not None else 0})
+            continue
+
+        if fields[0] != 'TRACE' or len(fields) != 5:
+            continue
+
+        ts, phase, track, name = int(fields[1]), fields[2], fields[3], fields[4]
+
+        # Unwrap timestamp. Only a drop by more than half the range is a wrap-around. A smaller step back
+        # (either way across the wrap) is an out-of-order record and is kept in place.
+        if ts_last is not None:
+            if ts_last - ts > TS_WRAP // 2:
+                ts_base += TS_WRAP
+            elif ts < ts_last or ts - ts_last > TS_WRAP // 2:
+                ts = ts_last
+        ts_last = ts
+
+        # One thread row per track, in order of appearance
+        tid = tids.setdefault(track, len(tids) + 1)
+
+        event = {'name': name, 'ph': phase, 'pid': 0, 'tid': tid, 'ts': ts_base + ts}
+        if phase == 'i':
+            event['s'] = 't'
+        events.append(event)
+
+    for track, tid in tids.items():
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': tid, 'args': {'name': track}})
+        events.append({'name': 'thread_sort_index', 'ph': 'M', 'pid': 0, 'tid': tid, 'args': {'sort_index': tid}})
+
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write('Usage: %s <serial log> [output.json]\n' % sys.argv[0])
+        return 1
+
+    with open(sys.argv[1], errors='replace') as f:
+        trace = convert(f)
+
+    if len(sys.argv) > 2:
+        with open(sys.argv[2], 'w') as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
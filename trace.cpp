@@ -0,0 +1,101 @@
+#include "mbed.h"
+#include "trace.h"
+#include "lp_ticker_api.h"
+
+#if MBED_CONF_APP_TRACE_ENABLE
+
+/* Max number of events held in buffer */
+#define TRACE_BUFFER_SIZE       MBED_CONF_APP_TRACE_BUFFER_SIZE
+
+/* One recorded event, 8 bytes
+ *
+ * NOTE: Timestamp is from lp_ticker, which keeps counting across power-down mode (deep sleep) but has
+ *       coarse resolution (~30 us with LXT/LIRC). It wraps around every ~71 minutes and the host converter
+ *       unwraps it.
+ */
+struct TraceRecord {
+    uint32_t    ts_us;
+    uint16_t    event;
+    uint8_t     phase;
+    uint8_t     reserved;
+};
+
+typedef std::pair<const char *, const char *> TraceName;
+
+/* Track and name of each TraceEvent */
+static const TraceName trace_name_arr[TraceEvent_Num] = {
+    TraceName("sleep", "Idle"),
+    TraceName("sleep", "Power-down"),
+    TraceName("sleep", "Wake-up from power-down"),
+    TraceName("isr", "PWRWU_IRQHandler"),
+    TraceName("isr", "WDT_IRQHandler"),
+    TraceName("isr", "RTC_IRQHandler"),
+    TraceName("isr", "nu_uart_cts_wakeup_handler"),
+    TraceName("isr", "nu_i2c_wakeup_handler"),
+    TraceName("isr", "Button"),
+    TraceName("isr", "Sensor sample"),
+    TraceName("main", "main loop"),
+    TraceName("rtc_loop", "rtc_loop"),
+    TraceName("poll_serial", "poll_serial"),
+    TraceName("poll_i2c", "poll_i2c"),
+    TraceName("main", "check_wakeup_source"),
+};
+
+static TraceRecord trace_buf[TRACE_BUFFER_SIZE];
+static size_t trace_head = 0;
+static size_t trace_count = 0;
+static uint32_t trace_dropped = 0;
+
+void trace_record(TraceEvent event, char phase)
+{
+    CriticalSectionLock lock;
+
+    /* Timestamp inside critical section, so that records are in timestamp order even if preempted */
+    uint32_t ts_us = (uint32_t) ticker_read_us(get_lp_ticker_data());
+
+    /* Keep older events on overflow, so that begin/end pairs already recorded are not broken */
+    if (trace_count == TRACE_BUFFER_SIZE) {
+        trace_dropped ++;
+        return;
+    }
+
+    TraceRecord *record = trace_buf + ((trace_head + trace_count) % TRACE_BUFFER_SIZE);
+    record->ts_us = ts_us;
+    record->event = event;
+    record->phase = phase;
+    record->reserved = 0;
+    trace_count ++;
+}
+
+size_t trace_pending(void)
+{
+    return trace_count;
+}
+
+void trace_dump(void)
+{
+    while (true) {
+        TraceRecord record;
+        uint32_t dropped;
+        {
+            CriticalSectionLock lock;
+
+            if (trace_count == 0) {
+                break;
+            }
+            record = trace_buf[trace_head];
+            trace_head = (trace_head + 1) % TRACE_BUFFER_SIZE;
+            trace_count --;
+            dropped = trace_dropped;
+            trace_dropped = 0;
+        }
+
+        if (dropped) {
+            printf("TRACE_DROPPED %lu\n", (unsigned long) dropped);
+        }
+        printf("TRACE %lu %c %s %s\n", (unsigned long) record.ts_us, record.phase,
+               trace_name_arr[record.event].first, trace_name_arr[record.event].second);
+    }
+}
+
+#endif  /* #if MBED_CONF_APP_TRACE_ENABLE */
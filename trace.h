@@ -0,0 +1,60 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "mbed.h"
+
+/* Timeline trace
+ *
+ * Begin/end events are recorded into a compact RAM buffer, and dumped to STDIO by trace_dump() as text lines:
+ *
+ *   TRACE <timestamp in us> <B|E|i> <track> <event>
+ *
+ * tools/trace2chrome.py converts the dump to Chrome trace/Perfetto JSON. Enabled by app.trace-enable
+ * in mbed_app.json5, otherwise all trace calls compile to nothing.
+ */
+enum TraceEvent {
+    /* Track: sleep */
+    TraceEvent_Sleep_Idle           = 0,
+    TraceEvent_Sleep_PowerDown,
+    /* Instant only. Mbed OS internal idle handler (MBED_TICKLESS) has no hook around sleep, so there the sleep
+     * track only has wake-ups recorded by PWRWU_IRQHandler. */
+    TraceEvent_Sleep_Wakeup,
+    /* Track: isr */
+    TraceEvent_IRQ_PWRWU,
+    TraceEvent_IRQ_WDT,
+    TraceEvent_IRQ_RTC,
+    TraceEvent_IRQ_UART_CTS,
+    TraceEvent_IRQ_I2C,
+    TraceEvent_IRQ_Button,
+    TraceEvent_IRQ_Sensor,
+    /* Track: thread */
+    TraceEvent_Thread_Main,
+    TraceEvent_Thread_RTC,
+    TraceEvent_Thread_Serial,
+    TraceEvent_Thread_I2C,
+    TraceEvent_Check_Wakeup_Source,
+
+    TraceEvent_Num,
+};
+
+#if MBED_CONF_APP_TRACE_ENABLE
+
+void trace_record(TraceEvent event, char phase);
+/* Number of events recorded but not yet dumped */
+size_t trace_pending(void);
+/* Dump and drain recorded events */
+void trace_dump(void);
+
+#define TRACE_BEGIN(event)      trace_record((event), 'B')
+#define TRACE_END(event)        trace_record((event), 'E')
+#define TRACE_INSTANT(event)    trace_record((event), 'i')
+
+#else
+
+#define TRACE_BEGIN(event)      do {} while (0)
+#define TRACE_END(event)        do {} while (0)
+#define TRACE_INSTANT(event)    do {} while (0)
+
+#endif  /* #if MBED_CONF_APP_TRACE_ENABLE */
+
+#endif  // __TRACE_H__
@@ -0,0 +1,352 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "wake_coro.h"
+#include "lp_ticker_api.h"
+#include "us_ticker_api.h"
+
+struct WakeLatency {
+    bool                posted;
+    us_timestamp_t      post_us;
+    uint32_t            resumes;
+    uint32_t            max_us;
+    us_timestamp_t      total_us;
+    /* RAM of handler thread, or 0 if it is coroutine */
+    uint32_t            thread_ram;
+};
+
+static WakeLatency latency_arr[NU_WAKEUP_TYPE_NUM];
+
+void wake_coro_mark_post(uint32_t eventflag)
+{
+    CriticalSectionLock lock;
+
+    WakeLatency *latency = latency_arr + __builtin_ctz(eventflag);
+    /* Measure from the first post not yet handled */
+    if (! latency->posted) {
+        latency->posted = true;
+        latency->post_us = ticker_read_us(get_us_ticker_data());
+    }
+}
+
+void wake_coro_mark_resume(uint32_t eventflag)
+{
+    CriticalSectionLock lock;
+
+    WakeLatency *latency = latency_arr + __builtin_ctz(eventflag);
+    if (! latency->posted) {
+        return;
+    }
+
+    uint32_t elapsed_us = ticker_read_us(get_us_ticker_data()) - latency->post_us;
+    latency->posted = false;
+    latency->resumes ++;
+    latency->total_us += elapsed_us;
+    if (elapsed_us > latency->max_us) {
+        latency->max_us = elapsed_us;
+    }
+}
+
+void wake_coro_account_thread(uint32_t eventflag, Thread *thread)
+{
+    CriticalSectionLock lock;
+
+    /* Stack plus control block, which is embedded in Thread */
+    latency_arr[__builtin_ctz(eventflag)].thread_ram = thread->stack_size() + sizeof (Thread);
+}
+
+#if WAKE_CORO_ENABLED
+
+#define NU_CORO_FRAME_NUM           MBED_CONF_APP_WAKE_CORO_FRAMES
+/* Round up for alignment of frame */
+#define NU_CORO_FRAME_SIZE          ((MBED_CONF_APP_WAKE_CORO_FRAME_SIZE + 7) & ~7)
+
+/* Scheduler-private event flags, beyond EventFlag_Wakeup_All */
+#define NU_CORO_FLAG_SPAWN          (1UL << 29)
+#define NU_CORO_FLAG_TIMER          (1UL << 30)
+#define NU_CORO_FLAG_ALL            (EventFlag_Wakeup_All | NU_CORO_FLAG_SPAWN | NU_CORO_FLAG_TIMER)
+
+/* Static frame pool */
+struct alignas(8) CoroFrame {
+    uint8_t     mem[NU_CORO_FRAME_SIZE];
+};
+
+static CoroFrame frame_pool[NU_CORO_FRAME_NUM];
+/* Size actually asked for by the compiler, 0 if free */
+static uint32_t frame_size_arr[NU_CORO_FRAME_NUM];
+static uint32_t frame_fail_count = 0;
+
+/* Suspended coroutine, waiting on either wake-up event or deadline. There is at most one per frame. */
+struct CoroWaiter {
+    std::coroutine_handle<>     handle;
+    uint32_t                    eventflag;
+    us_timestamp_t              deadline_us;
+};
+
+static CoroWaiter waiter_arr[NU_CORO_FRAME_NUM];
+
+/* Wake-up events posted but not yet consumed by coroutines. Touched by scheduler thread only. */
+static uint32_t pending_flags = 0;
+
+/* Coroutines to start on scheduler thread */
+static WakeTask (*spawn_arr[NU_CORO_FRAME_NUM])(void);
+static uint32_t spawn_num = 0;
+
+static EventFlags coro_eventflags;
+static LowPowerTimeout sleep_timeout;
+static Thread thread_coro(osPriorityNormal, MBED_CONF_APP_WAKE_CORO_STACK_SIZE);
+
+static void wake_coro_loop(void);
+static void wake_coro_dispatch(uint32_t flags);
+static void wake_coro_sleep_timeout(void);
+static CoroWaiter *wake_coro_alloc_waiter(void);
+static us_timestamp_t wake_coro_now_us(void);
+
+void *WakeTask::promise_type::operator new(size_t size) noexcept
+{
+    CriticalSectionLock lock;
+
+    if (size <= NU_CORO_FRAME_SIZE) {
+        for (int i = 0; i < NU_CORO_FRAME_NUM; i ++) {
+            if (frame_size_arr[i] == 0) {
+                frame_size_arr[i] = size;
+                return frame_pool + i;
+            }
+        }
+    }
+
+    frame_fail_count ++;
+    return nullptr;
+}
+
+void WakeTask::promise_type::operator delete(void *ptr) noexcept
+{
+    CriticalSectionLock lock;
+
+    frame_size_arr[static_cast<CoroFrame *>(ptr) - frame_pool] = 0;
+}
+
+bool WakeAwaiter::await_ready(void) const noexcept
+{
+    /* Event has come earlier. Consume it and go on without suspension. */
+    if (pending_flags & eventflag) {
+        pending_flags &= ~eventflag;
+        wake_coro_mark_resume(eventflag);
+        return true;
+    }
+
+    return false;
+}
+
+void WakeAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    CoroWaiter *waiter = wake_coro_alloc_waiter();
+    waiter->eventflag = eventflag;
+    waiter->handle = handle;
+}
+
+void SleepAwaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    CoroWaiter *waiter = wake_coro_alloc_waiter();
+    waiter->eventflag = 0;
+    waiter->deadline_us = wake_coro_now_us() + ms * 1000ULL;
+    /* NOTE: Called on scheduler thread, which re-arms timer for the earliest deadline after this round */
+    waiter->handle = handle;
+}
+
+void wake_coro_spawn(WakeTask (*task)(void))
+{
+    {
+        CriticalSectionLock lock;
+
+        MBED_ASSERT(spawn_num < NU_CORO_FRAME_NUM);
+        spawn_arr[spawn_num ++] = task;
+    }
+
+    /* Scheduler thread starts on first spawn */
+    static bool coro_started = false;
+    if (! coro_started) {
+        coro_started = true;
+        thread_coro.start(callback(&wake_coro_loop));
+    }
+
+    coro_eventflags.set(NU_CORO_FLAG_SPAWN);
+}
+
+void wake_coro_post(Source source)
+{
+    uint32_t eventflag = static_cast<uint32_t>(source);
+
+    wake_coro_mark_post(eventflag);
+    coro_eventflags.set(eventflag);
+}
+
+void wake_coro_poll(void)
+{
+    uint32_t flags = coro_eventflags.wait_any(NU_CORO_FLAG_ALL, 0, true);
+    if (flags & osFlagsError) {
+        return;
+    }
+
+    wake_coro_dispatch(flags);
+}
+
+static void wake_coro_loop(void)
+{
+    while (true) {
+        uint32_t flags = coro_eventflags.wait_any(NU_CORO_FLAG_ALL, osWaitForever, true);
+        if (flags & osFlagsError) {
+            printf("OS error code: 0x%08lX\n", flags);
+            continue;
+        }
+
+        wake_coro_dispatch(flags);
+    }
+}
+
+/* One scheduler round: start spawned coroutines, resume those whose event or deadline has come, and re-arm
+ * timer for the earliest deadline */
+static void wake_coro_dispatch(uint32_t flags)
+{
+    /* Start new coroutines. Each runs until its first suspension. */
+    if (flags & NU_CORO_FLAG_SPAWN) {
+        while (true) {
+            WakeTask (*task)(void) = nullptr;
+            {
+                CriticalSectionLock lock;
+
+                if (spawn_num) {
+                    task = spawn_arr[-- spawn_num];
+                }
+            }
+            if (task == nullptr) {
+                break;
+            }
+
+            if (! task().valid()) {
+                printf("%s: coroutine frame pool exhausted\n", __func__);
+            }
+        }
+    }
+
+    pending_flags |= flags & EventFlag_Wakeup_All;
+
+    /* Collect coroutines to resume first. Resuming one may re-wait on the same event, which must not be
+     * resumed again in this round. */
+    std::coroutine_handle<> ready_arr[NU_CORO_FRAME_NUM];
+    uint32_t ready_flag_arr[NU_CORO_FRAME_NUM];
+    int ready_num = 0;
+    us_timestamp_t now_us = wake_coro_now_us();
+
+    for (CoroWaiter &waiter : waiter_arr) {
+        if (! waiter.handle) {
+            continue;
+        }
+
+        if (waiter.eventflag) {
+            if (! (pending_flags & waiter.eventflag)) {
+                continue;
+            }
+            pending_flags &= ~waiter.eventflag;
+        } else if (waiter.deadline_us > now_us) {
+            continue;
+        }
+
+        ready_arr[ready_num] = waiter.handle;
+        ready_flag_arr[ready_num] = waiter.eventflag;
+        ready_num ++;
+        waiter.handle = nullptr;
+    }
+
+    for (int i = 0; i < ready_num; i ++) {
+        if (ready_flag_arr[i]) {
+            wake_coro_mark_resume(ready_flag_arr[i]);
+        }
+        ready_arr[i].resume();
+    }
+
+    /* Single lp_ticker timeout for the earliest deadline */
+    us_timestamp_t deadline_us = 0;
+    for (const CoroWaiter &waiter : waiter_arr) {
+        if (waiter.handle && waiter.eventflag == 0 && (deadline_us == 0 || waiter.deadline_us < deadline_us)) {
+            deadline_us = waiter.deadline_us;
+        }
+    }
+
+    if (deadline_us) {
+        now_us = wake_coro_now_us();
+        sleep_timeout.attach_us(&wake_coro_sleep_timeout, (deadline_us > now_us) ? (deadline_us - now_us) : 0);
+    } else {
+        sleep_timeout.detach();
+    }
+}
+
+static void wake_coro_sleep_timeout(void)
+{
+    /* Resumes scheduler thread only. Don't run the main loop for this wake-up. */
+    wakeup_isr_account(EventFlag_Wakeup_LPTicker, false);
+
+    coro_eventflags.set(NU_CORO_FLAG_TIMER);
+}
+
+static CoroWaiter *wake_coro_alloc_waiter(void)
+{
+    for (CoroWaiter &waiter : waiter_arr) {
+        if (! waiter.handle) {
+            return &waiter;
+        }
+    }
+
+    /* One suspended coroutine per frame at most */
+    MBED_ASSERT(false);
+    return nullptr;
+}
+
+static us_timestamp_t wake_coro_now_us(void)
+{
+    return ticker_read_us(get_lp_ticker_data());
+}
+
+#endif  /* #if WAKE_CORO_ENABLED */
+
+void wake_coro_dump_stats(void)
+{
+    for (int type = 0; type < NU_WAKEUP_TYPE_NUM; type ++) {
+        WakeLatency latency;
+        {
+            CriticalSectionLock lock;
+            latency = latency_arr[type];
+        }
+
+        if (latency.resumes == 0) {
+            continue;
+        }
+        printf("Wake-up 0x%03x: %s", 1 << type, latency.thread_ram ? "thread" : "coroutine");
+        if (latency.thread_ram) {
+            printf(" %lu bytes", (unsigned long) latency.thread_ram);
+        }
+        printf(", resume latency avg %llu us, max %lu us\n", latency.total_us / latency.resumes,
+               (unsigned long) latency.max_us);
+    }
+
+#if WAKE_CORO_ENABLED
+    uint32_t frame_size_snap[NU_CORO_FRAME_NUM];
+    uint32_t fail_count;
+    {
+        CriticalSectionLock lock;
+        memcpy(frame_size_snap, frame_size_arr, sizeof (frame_size_snap));
+        fail_count = frame_fail_count;
+    }
+
+    int frame_num = 0;
+    for (int i = 0; i < NU_CORO_FRAME_NUM; i ++) {
+        if (frame_size_snap[i]) {
+            printf("Coroutine frame %d: %lu/%lu bytes\n", i, (unsigned long) frame_size_snap[i],
+                   (unsigned long) NU_CORO_FRAME_SIZE);
+            frame_num ++;
+        }
+    }
+    printf("Coroutine scheduler: %lu bytes shared by %d coroutines, pool %lu bytes, %lu allocation failures\n",
+           (unsigned long) (thread_coro.stack_size() + sizeof (Thread)), frame_num,
+           (unsigned long) sizeof (frame_pool), (unsigned long) fail_count);
+#endif
+}
@@ -0,0 +1,155 @@
+#ifndef __WAKE_CORO_H__
+#define __WAKE_CORO_H__
+
+#include "mbed.h"
+#include "wakeup.h"
+
+/* Stackless coroutines for wake-up handlers
+ *
+ * Instead of one RTOS thread with its own stack per asynchronous wake-up source, handlers are written as
+ * coroutines which co_await wake-up events or time:
+ *
+ *   static WakeTask rtc_task(void)
+ *   {
+ *       while (true) {
+ *           co_await wake(Source::RtcAlarm);
+ *           ...
+ *       }
+ *   }
+ *
+ * Coroutine frames are allocated from a fixed static pool (app.wake-coro-frames x app.wake-coro-frame-size)
+ * and all coroutines are resumed by one scheduler thread. Enabled by app.wake-coroutine, which needs C++20
+ * coroutines: configure CMake with -DAPP_WAKE_COROUTINE=ON. Otherwise wake-up handlers run on their own
+ * threads as before.
+ *
+ * RAM per handler and resume latency (from posting in interrupt context to running the handler) are accounted
+ * in both designs, so that they can be compared through wake_coro_dump_stats().
+ *
+ * NOTE: Coroutines share the scheduler thread. One which blocks delays the others. Poll with
+ *       co_await sleep_for() instead (as I2C traffic polling does).
+ */
+#if MBED_CONF_APP_WAKE_COROUTINE
+#if (! defined(__cpp_impl_coroutine))
+#error "app.wake-coroutine needs C++20 coroutines. Configure CMake with -DAPP_WAKE_COROUTINE=ON."
+#endif
+#define WAKE_CORO_ENABLED   1
+#else
+#define WAKE_CORO_ENABLED   0
+#endif
+
+/* Resume latency accounting. Mark post in interrupt context and mark resume when the handler runs. */
+void wake_coro_mark_post(uint32_t eventflag);
+void wake_coro_mark_resume(uint32_t eventflag);
+/* Account RAM of handler thread for comparison with coroutine frames */
+void wake_coro_account_thread(uint32_t eventflag, Thread *thread);
+/* Print RAM per handler and resume latency */
+void wake_coro_dump_stats(void);
+
+#if WAKE_CORO_ENABLED
+
+#include <coroutine>
+
+/* Wake-up sources which coroutines can wait on */
+enum class Source : uint32_t {
+    RtcAlarm        = EventFlag_Wakeup_RTC_Alarm,
+    UartCts         = EventFlag_Wakeup_UART_CTS,
+    I2cAddrMatch    = EventFlag_Wakeup_I2C_AddrMatch,
+};
+
+/* Fire-and-forget coroutine. Runs until its first suspension on spawn and frees its frame on completion. */
+class WakeTask {
+public:
+    struct promise_type {
+        WakeTask get_return_object() noexcept
+        {
+            return WakeTask(true);
+        }
+
+        /* Frame pool exhausted */
+        static WakeTask get_return_object_on_allocation_failure() noexcept
+        {
+            return WakeTask(false);
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        void unhandled_exception() noexcept
+        {
+        }
+
+        static void *operator new(size_t size) noexcept;
+        static void operator delete(void *ptr) noexcept;
+    };
+
+    bool valid(void) const
+    {
+        return _valid;
+    }
+
+private:
+    explicit WakeTask(bool valid) : _valid(valid)
+    {
+    }
+
+    bool    _valid;
+};
+
+/* Awaiter: resume on wake-up event of source. Like a binary semaphore, an event posted while the coroutine
+ * is not waiting is kept and consumed by the next wait. */
+struct WakeAwaiter {
+    uint32_t    eventflag;
+
+    bool await_ready(void) const noexcept;
+    void await_suspend(std::coroutine_handle<> handle) noexcept;
+    void await_resume(void) const noexcept
+    {
+    }
+};
+
+/* Awaiter: resume after a while */
+struct SleepAwaiter {
+    uint32_t    ms;
+
+    bool await_ready(void) const noexcept
+    {
+        return ms == 0;
+    }
+    void await_suspend(std::coroutine_handle<> handle) noexcept;
+    void await_resume(void) const noexcept
+    {
+    }
+};
+
+inline WakeAwaiter wake(Source source)
+{
+    return WakeAwaiter{static_cast<uint32_t>(source)};
+}
+
+inline SleepAwaiter sleep_for(uint32_t ms)
+{
+    return SleepAwaiter{ms};
+}
+
+/* Start coroutine on the scheduler thread. Callable before the scheduler starts. */
+void wake_coro_spawn(WakeTask (*task)(void));
+/* Post wake-up event of source. Callable in interrupt context. */
+void wake_coro_post(Source source);
+/* Run one scheduler round on events already posted, without blocking. For host tests, which have no
+ * scheduler thread. */
+void wake_coro_poll(void);
+
+#endif  /* #if WAKE_CORO_ENABLED */
+
+#endif  // __WAKE_CORO_H__
@@ -15,16 +15,81 @@ enum EventFlag_Wakeup {
     
     EventFlag_Wakeup_UnID           = (1 << 7),
     
-    EventFlag_Wakeup_All            = 0xFF,
+    EventFlag_Wakeup_SensorBatch    = (1 << 8),
+    
+    EventFlag_Wakeup_Storm          = (1 << 9),
+    
+    EventFlag_Wakeup_All            = 0x3FF,
+};
+
+/* Number of wake-up types, one per EventFlag_Wakeup_xxx bit. Per-type arrays are indexed by bit position. */
+#define NU_WAKEUP_TYPE_NUM          (32 - __builtin_clz(EventFlag_Wakeup_All))
+
+/* Button gestures reported along with EventFlag_Wakeup_Button1/2 */
+enum ButtonGesture {
+    ButtonGesture_None              = 0,
+    ButtonGesture_Short,
+    ButtonGesture_Long,
+    ButtonGesture_Double,
+    ButtonGesture_HoldRepeat,
 };
 
 extern EventFlags wakeup_eventflags;
 
+/* Notify wake-up event. Counted in statistics, and set to wakeup_eventflags unless the source is ISR-only
+ * (app.isr-only-wakeup-sources). */
+void wakeup_notify(uint32_t eventflag);
+/* Accept wake-up event in interrupt context before handing it to thread. Counted in statistics and
+ * throttled on wake-up storm like wakeup_notify(). Return false if held back, so that the handler drops it
+ * without waking up thread. The thread then notifies it through wakeup_notify_deferred(). */
+bool wakeup_accept(uint32_t eventflag);
+void wakeup_notify_deferred(uint32_t eventflag);
+bool wakeup_is_isr_only(uint32_t eventflag);
+/* Account event of interrupt handler for power-down wake-up in progress, without notifying it. notified
+ * tells whether the event is (or will be) set to wakeup_eventflags. wakeup_notify() accounts on its own. */
+void wakeup_isr_account(uint32_t eventflag, bool notified);
+/* Called by PWRWU_IRQHandler after wake-up source interrupt handlers. Notify EventFlag_Wakeup_UnID unless
+ * the wake-up was handled in interrupt context only. */
+void wakeup_notify_pdwu(void);
+/* Whether PWRWU interrupt is pending, i.e. power-down wake-up is in progress */
+bool wakeup_pdwu_pending(void);
+/* Sources accounted on last power-down wake-up, or EventFlag_Wakeup_UnID if none */
+uint32_t wakeup_pdwu_sources(void);
+/* Called by idle handler on each wake-up. Return true to go back to sleep directly because the wake-up
+ * was handled in interrupt context only. */
+bool wakeup_sleep_on_exit(bool tick_due);
+/* Print wake-up event counts */
+void wakeup_dump_stats(void);
+
+/* Wake-up storm throttling. Rate limit per source is app.storm-rate/app.storm-burst by default. */
+void wakeup_storm_set_limit(uint32_t eventflag, uint32_t rate, uint32_t burst);
+/* Hook to mask/unmask the source's wake-up enable while it is throttled. Called in critical section. */
+void wakeup_storm_set_mask_hook(uint32_t eventflag, void (*mask_hook)(uint32_t eventflag, bool masked));
+/* Hook to deliver the pending count of held-back events on re-enable, e.g. by posting the source's handler
+ * thread. Called in interrupt context. Return true if the batch will be notified to the main loop. Without
+ * hook, the source is notified to the main loop directly. */
+void wakeup_storm_set_deliver_hook(uint32_t eventflag, bool (*deliver_hook)(uint32_t eventflag, uint32_t pending));
+/* Return events allowed to notify now. Adds EventFlag_Wakeup_Storm when some source gets throttled. */
+uint32_t wakeup_storm_filter(uint32_t eventflag);
+/* Fetch and clear sources which have entered storm */
+uint32_t wakeup_storm_fetch(void);
+void wakeup_storm_dump_stats(void);
+
 void config_pwrctl(void);
 void config_button_wakeup(void);
 void config_wdt_wakeup(void);
 void config_rtc_wakeup(void);
 void config_uart_wakeup(void);
 void config_i2c_wakeup(void);
+void config_sensor_batch_wakeup(void);
+
+/* Fetch and clear the latest gesture of the button identified by EventFlag_Wakeup_Button1/2 */
+ButtonGesture button_gesture_fetch(uint32_t eventflag);
+
+/* Fetch and clear error of re-arming RTC alarm in interrupt context, or NULL if none */
+const char *rtc_alarm_error_fetch(void);
+
+/* Fetch the ready sensor batch into buf and return number of samples, or 0 if no batch is ready */
+size_t sensor_batch_fetch(uint16_t *buf, size_t max_samples);
 
 #endif  // target-power.h
@@ -1,5 +1,8 @@
 #include "mbed.h"
 #include "wakeup.h"
+#include "lp_ticker_api.h"
+#include "trace.h"
+#include "pwrmode.h"
 
 #if defined(TARGET_NUMAKER_PFM_NANO130)
 // SW
@@ -35,50 +38,243 @@
 
 #if defined(BUTTON1) && defined(BUTTON2)
 
-static InterruptIn button1(BUTTON1);
-static InterruptIn button2(BUTTON2);
-static void button1_release(void);
-static void button2_release(void);
+/* Gesture timing */
+#define BUTTON_LONG_PRESS_US        (800 * 1000)
+#define BUTTON_DOUBLE_CLICK_GAP_US  (300 * 1000)
+#define BUTTON_HOLD_REPEAT_US       (500 * 1000)
 
-#if defined(TARGET_NUMAKER_PFM_NANO130)
-static void button1_press(void);
-static void button2_press(void);
-#endif
+/* Gesture engine
+ *
+ * Edges are timestamped by lp_ticker in interrupt context, and one low-power timeout is armed for the next
+ * decision point. Only the recognized gesture is notified. Edges and decision timeouts are otherwise handled
+ * in interrupt context only (see wakeup_isr_account()), so the main loop runs once per gesture rather than
+ * per edge. Edges go through the storm filter, so that chattering button gets masked rather than only its
+ * gestures counted.
+ *
+ *   Idle --press--> Pressed --release--> WaitClick --timeout--> Idle (short)
+ *                   |                    |
+ *                   |                    +--press--> Pressed --release--> Idle (double)
+ *                   +--timeout--> Holding (long) --timeout--> Holding (hold-repeat) --release--> Idle
+ */
+enum ButtonState {
+    ButtonState_Idle,
+    ButtonState_Pressed,
+    ButtonState_WaitClick,
+    ButtonState_Holding,
+};
+
+struct ButtonGestureEngine {
+    InterruptIn                 button;
+    const uint32_t              eventflag;
+    ButtonState                 state;
+    us_timestamp_t              press_us;
+    uint8_t                     clicks;
+    LowPowerTimeout             decision;
+    volatile ButtonGesture      gesture;
+
+    ButtonGestureEngine(PinName pin, uint32_t eventflag_) :
+        button(pin),
+        eventflag(eventflag_),
+        state(ButtonState_Idle),
+        press_us(0),
+        clicks(0),
+        gesture(ButtonGesture_None)
+    {
+    }
+};
+
+static ButtonGestureEngine button_arr[] = {
+    {BUTTON1, EventFlag_Wakeup_Button1},
+    {BUTTON2, EventFlag_Wakeup_Button2},
+};
+
+static void button_press(ButtonGestureEngine *engine);
+static void button_release(ButtonGestureEngine *engine);
+static void button_decide(ButtonGestureEngine *engine);
+static void button_report(ButtonGestureEngine *engine, ButtonGesture gesture);
+static void button_arm(ButtonGestureEngine *engine, us_timestamp_t us);
+static bool button_edge_accept(ButtonGestureEngine *engine);
+static void button_storm_mask(uint32_t eventflag, bool masked);
+static bool button_storm_deliver(uint32_t eventflag, uint32_t pending);
 
 void config_button_wakeup(void)
 {
-    button1.rise(&button1_release);
-    button2.rise(&button2_release);
-    
-    /* KNOWN ISSUE: On NANO130 (NANO100 series), there's H/W issue with GPIO wake-up from 
-     *              Power-down (deep sleep). Workaround by enabling both edge triggers. */
-#if defined(TARGET_NUMAKER_PFM_NANO130)
-    button1.fall(&button1_press);
-    button2.fall(&button2_press);
-#endif
+    /* Buttons are active low. Gesture recognition needs both edges.
+     *
+     * KNOWN ISSUE: On NANO130 (NANO100 series), there's H/W issue with GPIO wake-up from 
+     *              Power-down (deep sleep). Enabling both edge triggers is also the workaround. */
+    for (ButtonGestureEngine &engine : button_arr) {
+        engine.button.fall(callback(&button_press, &engine));
+        engine.button.rise(callback(&button_release, &engine));
+        pwrmode_enable_wakeup_source(engine.eventflag);
+        /* Stop chattering button from waking us up on each edge */
+        wakeup_storm_set_mask_hook(engine.eventflag, &button_storm_mask);
+        wakeup_storm_set_deliver_hook(engine.eventflag, &button_storm_deliver);
+    }
 }
 
-void button1_release(void)
+ButtonGesture button_gesture_fetch(uint32_t eventflag)
 {
-    wakeup_eventflags.set(EventFlag_Wakeup_Button1);
+    CriticalSectionLock lock;
+
+    for (ButtonGestureEngine &engine : button_arr) {
+        if (engine.eventflag == eventflag) {
+            ButtonGesture gesture = engine.gesture;
+            engine.gesture = ButtonGesture_None;
+            return gesture;
+        }
+    }
+
+    return ButtonGesture_None;
 }
 
-void button2_release(void)
+static void button_press(ButtonGestureEngine *engine)
 {
-    wakeup_eventflags.set(EventFlag_Wakeup_Button2);
+    TRACE_INSTANT(TraceEvent_IRQ_Button);
+
+    if (! button_edge_accept(engine)) {
+        return;
+    }
+
+    switch (engine->state) {
+        case ButtonState_Idle:
+            engine->clicks = 0;
+            /* Fall through */
+        case ButtonState_WaitClick:
+            engine->state = ButtonState_Pressed;
+            engine->press_us = ticker_read_us(get_lp_ticker_data());
+            button_arm(engine, BUTTON_LONG_PRESS_US);
+            break;
+
+        default:
+            /* Bounce */
+            break;
+    }
 }
 
-#if defined(TARGET_NUMAKER_PFM_NANO130)
-void button1_press(void)
+static void button_release(ButtonGestureEngine *engine)
 {
-    wakeup_eventflags.set(EventFlag_Wakeup_Button1);
+    TRACE_INSTANT(TraceEvent_IRQ_Button);
+
+    if (! button_edge_accept(engine)) {
+        return;
+    }
+
+    switch (engine->state) {
+        case ButtonState_Pressed:
+            if ((ticker_read_us(get_lp_ticker_data()) - engine->press_us) >= BUTTON_LONG_PRESS_US) {
+                /* Decision point has passed but its timeout is not yet handled */
+                engine->decision.detach();
+                engine->state = ButtonState_Idle;
+                button_report(engine, ButtonGesture_Long);
+            } else if (engine->clicks) {
+                engine->decision.detach();
+                engine->state = ButtonState_Idle;
+                button_report(engine, ButtonGesture_Double);
+            } else {
+                engine->clicks = 1;
+                engine->state = ButtonState_WaitClick;
+                button_arm(engine, BUTTON_DOUBLE_CLICK_GAP_US);
+            }
+            break;
+
+        case ButtonState_Holding:
+            engine->decision.detach();
+            engine->state = ButtonState_Idle;
+            break;
+
+        default:
+            /* Bounce */
+            break;
+    }
 }
 
-void button2_press(void)
+static void button_decide(ButtonGestureEngine *engine)
 {
-    wakeup_eventflags.set(EventFlag_Wakeup_Button2);
+    /* Decision timeout is handled here. Only a recognized gesture runs the main loop. */
+    wakeup_isr_account(engine->eventflag, false);
+
+    switch (engine->state) {
+        case ButtonState_Pressed:
+            engine->state = ButtonState_Holding;
+            button_arm(engine, BUTTON_HOLD_REPEAT_US);
+            button_report(engine, ButtonGesture_Long);
+            break;
+
+        case ButtonState_Holding:
+            button_arm(engine, BUTTON_HOLD_REPEAT_US);
+            button_report(engine, ButtonGesture_HoldRepeat);
+            break;
+
+        case ButtonState_WaitClick:
+            engine->state = ButtonState_Idle;
+            button_report(engine, ButtonGesture_Short);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Edge is handled here. Only a recognized gesture runs the main loop. Return false if held back on storm. */
+static bool button_edge_accept(ButtonGestureEngine *engine)
+{
+    uint32_t passed = wakeup_storm_filter(engine->eventflag);
+
+    wakeup_isr_account(engine->eventflag, (passed & EventFlag_Wakeup_Storm) != 0);
+    if (passed & EventFlag_Wakeup_Storm) {
+        wakeup_eventflags.set(EventFlag_Wakeup_Storm);
+    }
+
+    return (passed & engine->eventflag) != 0;
+}
+
+static void button_report(ButtonGestureEngine *engine, ButtonGesture gesture)
+{
+    /* Unfetched gesture is overwritten. If notification is held back on storm, the gesture is delivered on
+     * re-enable (see button_storm_deliver()). */
+    engine->gesture = gesture;
+    wakeup_notify(engine->eventflag);
+}
+
+static void button_arm(ButtonGestureEngine *engine, us_timestamp_t us)
+{
+    engine->decision.attach_us(callback(&button_decide, engine), us);
+}
+
+static void button_storm_mask(uint32_t eventflag, bool masked)
+{
+    for (ButtonGestureEngine &engine : button_arr) {
+        if (engine.eventflag != eventflag) {
+            continue;
+        }
+
+        if (masked) {
+            engine.button.disable_irq();
+            engine.decision.detach();
+        } else {
+            /* Gesture in progress is lost. Start over. */
+            engine.state = ButtonState_Idle;
+            engine.button.enable_irq();
+        }
+    }
+}
+
+/* Held-back edges make no gesture, and the gesture in progress has been reset on unmask. Deliver only a
+ * recognized gesture whose notification was held back itself. */
+static bool button_storm_deliver(uint32_t eventflag, uint32_t pending)
+{
+    (void) pending;
+
+    for (ButtonGestureEngine &engine : button_arr) {
+        if (engine.eventflag == eventflag && engine.gesture != ButtonGesture_None) {
+            wakeup_eventflags.set(eventflag);
+            return true;
+        }
+    }
+
+    return false;
 }
-#endif
 
 #else
 
@@ -87,4 +283,11 @@ void config_button_wakeup(void)
     printf("Disable button wake-up on this target\n\n");
 }
 
+ButtonGesture button_gesture_fetch(uint32_t eventflag)
+{
+    (void) eventflag;
+
+    return ButtonGesture_None;
+}
+
 #endif /* #if defined(BUTTON1) && defined(BUTTON2) */
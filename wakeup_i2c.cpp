@@ -1,9 +1,19 @@
 #include "mbed.h"
 #include "wakeup.h"
+#include "pm_qos.h"
+#include "trace.h"
+#include "pwrmode.h"
+#include "clk_ramp.h"
+#include "wake_coro.h"
 #include "PeripheralPins.h"
 
 #define I2C_ADDR    (0x90)
 
+/* Wake-up latency we can tolerate during I2C transaction, short enough to exclude Power-down mode */
+#define I2C_MAX_WAKEUP_LATENCY_US   100
+/* Time to keep the request after I2C traffic is over, expecting follow-up transactions from I2C master */
+#define I2C_QOS_LINGER_US           (1000 * 1000)
+
 #if defined(TARGET_NUMAKER_PFM_NUC472)
 // I2C
 #define I2C_SDA     D14
@@ -27,76 +37,226 @@
 #endif
 
 /* NOTE: Per test (on NUC472/M453/M487), we could handle in time from idle mode (shallow sleep) wake-up, 
- *       but fail from power-down mode (deep sleep). */
+ *       but fail from power-down mode (deep sleep). So we keep out of power-down mode through latency
+ *       tolerance request during I2C transaction and for I2C_QOS_LINGER_US after it. */
+/* NOTE: Trade-off: The request is added only after I2C wake-up. The first transaction after idle longer
+ *       than I2C_QOS_LINGER_US still wakes up from power-down mode and may fail. I2C master is expected to
+ *       retry it, and follow-up transactions are served from idle mode. Holding the request all the time
+ *       I2C wake-up is configured would avoid that but keep the system out of power-down mode entirely. */
 
+#if WAKE_CORO_ENABLED
+static WakeTask i2c_task(void);
+#else
 /* Support wake-up by I2C traffic */
 static Semaphore sem_i2c(0, 1);
 
 static void poll_i2c(void);
+#endif
+/* With no I2C traffic for this time, we go back to wait on next I2C traffic */
+#define I2C_TRAFFIC_IDLE_US         5000
+
+static void i2c_traffic_begin(void);
+static bool i2c_traffic_poll(I2CSlave &i2c_slave, bool *has_notified_wakeup);
+static void i2c_traffic_end(void);
 /* This handler is to be called in I2C interrupt context (which is extended by Nuvoton's I2C HAL implementation 
  * on mbed OS) to support wake-up by I2C traffic. */
 extern "C" void nu_i2c_wakeup_handler(I2C_T *i2c_base);
 
+/* I2C which has woken us up, for masking its wake-up enable on storm */
+static I2C_T * volatile i2c_wake_base = NULL;
+
+static void i2c_storm_mask(uint32_t eventflag, bool masked);
+static bool i2c_storm_deliver(uint32_t eventflag, uint32_t pending);
+static void i2c_post(void);
+
 void config_i2c_wakeup(void)
 {
     /* I2C engine is clocked by external I2C bus clock, so its support for wake-up is irrespective of HXT/HIRC
      * which are disabled during deep sleep (power-down). */
     
+    pwrmode_enable_wakeup_source(EventFlag_Wakeup_I2C_AddrMatch);
+    /* Stop flooding I2C master from waking us up on each transaction */
+    wakeup_storm_set_mask_hook(EventFlag_Wakeup_I2C_AddrMatch, &i2c_storm_mask);
+    wakeup_storm_set_deliver_hook(EventFlag_Wakeup_I2C_AddrMatch, &i2c_storm_deliver);
+
+#if WAKE_CORO_ENABLED
+    wake_coro_spawn(&i2c_task);
+#else
     static Thread thread_i2c;
+
+    wake_coro_account_thread(EventFlag_Wakeup_I2C_AddrMatch, &thread_i2c);
     
     Callback<void()> callback(&poll_i2c);
     thread_i2c.start(callback);
+#endif
 }
 
-static void poll_i2c(void)
+#if WAKE_CORO_ENABLED
+static WakeTask i2c_task(void)
 {
     static I2CSlave i2c_slave(I2C_SDA, I2C_SCL);
 
-    static char i2c_buf[32];
+    i2c_slave.address(I2C_ADDR);
+
+    while (true) {
+        co_await wake(Source::I2cAddrMatch);
+        TRACE_BEGIN(TraceEvent_Thread_I2C);
+
+        i2c_traffic_begin();
+
+        /* Poll I2C traffic back to back while there is some. Otherwise, sleep 1 ms between polls so that
+         * other coroutines can run meanwhile. */
+        bool has_notified_wakeup = false;
+        uint32_t idle_ms = 0;
+        while (idle_ms < (I2C_TRAFFIC_IDLE_US / 1000)) {
+            if (i2c_traffic_poll(i2c_slave, &has_notified_wakeup)) {
+                idle_ms = 0;
+            } else {
+                co_await sleep_for(1);
+                idle_ms ++;
+            }
+        }
+
+        i2c_traffic_end();
+        TRACE_END(TraceEvent_Thread_I2C);
+    }
+}
+#else
+static void poll_i2c(void)
+{
+    static I2CSlave i2c_slave(I2C_SDA, I2C_SCL);
     
     i2c_slave.address(I2C_ADDR);
     
     while (true) {
         sem_i2c.acquire();
+        wake_coro_mark_resume(EventFlag_Wakeup_I2C_AddrMatch);
+        TRACE_BEGIN(TraceEvent_Thread_I2C);
+
+        i2c_traffic_begin();
 
         bool has_notified_wakeup = false;
         /* This timer is to check if there is I2C traffic remaining. */
         Timer timer;
         timer.start();
-        
-        /* With no I2C traffic for 5 ms, we go back to wait on next I2C traffic. */
-        while (timer.read_high_resolution_us() < 5000) {
-            /* We shall call I2CSlave::receive to enable I2C interrupt again which may be disabled in handling 
-             * I2C interrupt in Nuvoton's I2C HAL implementation on mbed OS. */
-            int addr_status = i2c_slave.receive();
-            switch (addr_status) {
-                case I2CSlave::ReadAddressed:
-                    if (! has_notified_wakeup) {
-                        has_notified_wakeup = true;
-                        wakeup_eventflags.set(EventFlag_Wakeup_I2C_AddrMatch);
-                    }
-                    i2c_slave.write(i2c_buf, sizeof (i2c_buf));
-                    timer.reset();
-                    break;
-                
-                case I2CSlave::WriteAddressed:
-                    if (! has_notified_wakeup) {
-                        has_notified_wakeup = true;
-                        wakeup_eventflags.set(EventFlag_Wakeup_I2C_AddrMatch);
-                    }
-                    i2c_slave.read(i2c_buf, sizeof (i2c_buf));
-                    timer.reset();
-                    break;
+
+        while (timer.read_high_resolution_us() < I2C_TRAFFIC_IDLE_US) {
+            if (i2c_traffic_poll(i2c_slave, &has_notified_wakeup)) {
+                timer.reset();
             }
         }
+
+        i2c_traffic_end();
+        TRACE_END(TraceEvent_Thread_I2C);
+    }
+}
+#endif
+
+/* Latency tolerance request during I2C traffic */
+static PmQosRequest i2c_qos;
+
+static void i2c_traffic_begin(void)
+{
+    /* I2C engine is clocked by PCLK. Run at full clock. */
+    clk_ramp_request();
+
+    /* Keep out of power-down mode until I2C traffic is over */
+    i2c_qos.add(I2C_MAX_WAKEUP_LATENCY_US);
+}
+
+/* Serve one I2C transaction if addressed. Return true if there was traffic. */
+static bool i2c_traffic_poll(I2CSlave &i2c_slave, bool *has_notified_wakeup)
+{
+    static char i2c_buf[32];
+
+    /* We shall call I2CSlave::receive to enable I2C interrupt again which may be disabled in handling 
+     * I2C interrupt in Nuvoton's I2C HAL implementation on mbed OS. */
+    int addr_status = i2c_slave.receive();
+    switch (addr_status) {
+        case I2CSlave::ReadAddressed:
+            if (! *has_notified_wakeup) {
+                *has_notified_wakeup = true;
+                wakeup_notify_deferred(EventFlag_Wakeup_I2C_AddrMatch);
+            }
+            i2c_slave.write(i2c_buf, sizeof (i2c_buf));
+            return true;
+        
+        case I2CSlave::WriteAddressed:
+            if (! *has_notified_wakeup) {
+                *has_notified_wakeup = true;
+                wakeup_notify_deferred(EventFlag_Wakeup_I2C_AddrMatch);
+            }
+            i2c_slave.read(i2c_buf, sizeof (i2c_buf));
+            return true;
     }
+
+    return false;
+}
+
+static void i2c_traffic_end(void)
+{
+    /* Follow-up transactions are likely. Keep out of power-down mode for a while. */
+    i2c_qos.add(I2C_MAX_WAKEUP_LATENCY_US, I2C_QOS_LINGER_US);
 }
 
 void nu_i2c_wakeup_handler(I2C_T *i2c_base)
 {
-    (void) i2c_base;
+    TRACE_BEGIN(TraceEvent_IRQ_I2C);
+
+    i2c_wake_base = i2c_base;
 
     /* FIXME: Clear wake-up event to enable re-entering Power-down mode */
 
+    /* Throttle storm here rather than in thread, so that held-back events don't wake up thread */
+    if (wakeup_accept(EventFlag_Wakeup_I2C_AddrMatch)) {
+        i2c_post();
+    }
+
+    TRACE_END(TraceEvent_IRQ_I2C);
+}
+
+/* Hand event off to thread */
+static void i2c_post(void)
+{
+#if WAKE_CORO_ENABLED
+    wake_coro_post(Source::I2cAddrMatch);
+#else
+    wake_coro_mark_post(EventFlag_Wakeup_I2C_AddrMatch);
     sem_i2c.release();
+#endif
+}
+
+/* NOTE: Called in critical section */
+static void i2c_storm_mask(uint32_t eventflag, bool masked)
+{
+    (void) eventflag;
+
+#if defined(TARGET_M451) || defined(TARGET_M480) || defined(TARGET_M460) || defined(TARGET_M261) || defined(TARGET_M251)
+    I2C_T *i2c_base = i2c_wake_base;
+    if (i2c_base == NULL) {
+        return;
+    }
+
+    if (masked) {
+        i2c_base->WKCTL &= ~I2C_WKCTL_WKEN_Msk;
+    } else {
+        i2c_base->WKCTL |= I2C_WKCTL_WKEN_Msk;
+    }
+#else
+    /* NOTE: Wake-up enable differs in register layout on NUC472/NANO100 and is left enabled. Held-back
+     *       events still wake up CPU but are dropped in nu_i2c_wakeup_handler(). */
+    (void) masked;
+#endif
+}
+
+/* Held-back events were dropped in interrupt handler. Run thread once for the whole batch, so that it calls
+ * I2CSlave::receive() to enable I2C interrupt again. */
+static bool i2c_storm_deliver(uint32_t eventflag, uint32_t pending)
+{
+    (void) eventflag;
+    (void) pending;
+
+    i2c_post();
+    /* Thread notifies main loop only if there is I2C traffic still */
+    return false;
 }
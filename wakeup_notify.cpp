@@ -0,0 +1,162 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "rtx_os.h"
+
+/* Wake-up sources classified as ISR-only
+ *
+ * Their events are fully handled in interrupt context. They are counted in statistics but don't set
+ * wakeup_eventflags, so no thread is woken up for them.
+ */
+#define NU_ISR_ONLY_SOURCES         (MBED_CONF_APP_ISR_ONLY_WAKEUP_SOURCES & ~EventFlag_Wakeup_UnID)
+
+/* Power-down wake-up resolution
+ *
+ * PWRWU_IRQHandler runs at lower priority than wake-up source interrupts (see config_pwrctl()). On wake-up
+ * from power-down, source interrupt handlers thus run first, while PWRWU interrupt is still pending, and
+ * account their events here. PWRWU_IRQHandler then notifies EventFlag_Wakeup_UnID only if some event is
+ * notified to thread, or if none is accounted (source unidentified). Wake-ups handled in interrupt context
+ * only don't run the main loop, with either Mbed OS internal or customized idle handler.
+ */
+
+static uint32_t notify_count_arr[NU_WAKEUP_TYPE_NUM];
+
+/* Power-down wake-up in progress */
+static uint32_t pdwu_sources = 0;
+static bool pdwu_notified = false;
+/* Sources of last power-down wake-up */
+static uint32_t pdwu_last_sources = EventFlag_Wakeup_UnID;
+/* Power-down wake-ups handled in interrupt context only */
+static uint32_t pdwu_isr_count = 0;
+
+static uint32_t resleep_count = 0;
+
+void wakeup_notify(uint32_t eventflag)
+{
+    {
+        CriticalSectionLock lock;
+
+        for (uint32_t flags = eventflag; flags; flags &= flags - 1) {
+            notify_count_arr[__builtin_ctz(flags)] ++;
+        }
+
+        uint32_t sources = eventflag;
+
+        /* Hold back events of sources in wake-up storm */
+        eventflag = wakeup_storm_filter(eventflag) & ~NU_ISR_ONLY_SOURCES;
+
+        wakeup_isr_account(sources, eventflag != 0);
+    }
+
+    if (eventflag) {
+        wakeup_eventflags.set(eventflag);
+    }
+}
+
+bool wakeup_accept(uint32_t eventflag)
+{
+    uint32_t passed;
+    {
+        CriticalSectionLock lock;
+
+        for (uint32_t flags = eventflag; flags; flags &= flags - 1) {
+            notify_count_arr[__builtin_ctz(flags)] ++;
+        }
+
+        /* Hold back events of sources in wake-up storm */
+        passed = wakeup_storm_filter(eventflag);
+
+        /* Thread notifies main loop later unless the source is ISR-only */
+        wakeup_isr_account(eventflag, (passed & ~NU_ISR_ONLY_SOURCES) != 0);
+    }
+
+    /* Storm is notified to main loop right away */
+    if (passed & EventFlag_Wakeup_Storm) {
+        wakeup_eventflags.set(EventFlag_Wakeup_Storm);
+    }
+
+    return (passed & eventflag) != 0;
+}
+
+void wakeup_notify_deferred(uint32_t eventflag)
+{
+    /* Counted and filtered by wakeup_accept() already */
+    eventflag &= ~NU_ISR_ONLY_SOURCES;
+
+    if (eventflag) {
+        wakeup_eventflags.set(eventflag);
+    }
+}
+
+void wakeup_isr_account(uint32_t eventflag, bool notified)
+{
+    CriticalSectionLock lock;
+
+    if (! wakeup_pdwu_pending()) {
+        return;
+    }
+
+    pdwu_sources |= eventflag;
+    pdwu_notified = pdwu_notified || notified;
+}
+
+void wakeup_notify_pdwu(void)
+{
+    bool notify_unid;
+    {
+        CriticalSectionLock lock;
+
+        notify_unid = pdwu_notified || pdwu_sources == 0;
+        pdwu_last_sources = pdwu_sources ? pdwu_sources : (uint32_t) EventFlag_Wakeup_UnID;
+        if (! notify_unid) {
+            pdwu_isr_count ++;
+        }
+
+        pdwu_sources = 0;
+        pdwu_notified = false;
+    }
+
+    if (notify_unid) {
+        wakeup_notify(EventFlag_Wakeup_UnID);
+    }
+}
+
+uint32_t wakeup_pdwu_sources(void)
+{
+    return core_util_atomic_load_u32(&pdwu_last_sources);
+}
+
+bool wakeup_is_isr_only(uint32_t eventflag)
+{
+    return (eventflag & NU_ISR_ONLY_SOURCES) == eventflag;
+}
+
+bool wakeup_sleep_on_exit(bool tick_due)
+{
+    CriticalSectionLock lock;
+
+    /* With kernel suspended, threads made ready by interrupt handlers are not yet switched to and stay
+     * in ready list. Empty ready list means the wake-up was handled in interrupt context only. */
+    if (! tick_due && osRtxInfo.thread.ready.thread_list == NULL) {
+        resleep_count ++;
+        return true;
+    }
+
+    return false;
+}
+
+void wakeup_dump_stats(void)
+{
+    for (int type = 0; type < NU_WAKEUP_TYPE_NUM; type ++) {
+        uint32_t count = core_util_atomic_load_u32(notify_count_arr + type);
+        if (count) {
+            printf("Wake-up 0x%03x: %lu events%s\n", 1 << type, (unsigned long) count,
+                   wakeup_is_isr_only(1 << type) ? " (ISR-only)" : "");
+        }
+    }
+
+    printf("Power-down wake-ups handled in ISR only: %lu\n",
+           (unsigned long) core_util_atomic_load_u32(&pdwu_isr_count));
+#if (! defined(MBED_TICKLESS))
+    printf("Sleep-on-exit: %lu re-sleeps\n", (unsigned long) core_util_atomic_load_u32(&resleep_count));
+#endif
+}
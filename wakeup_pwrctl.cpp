@@ -1,6 +1,13 @@
 #include "mbed.h"
 #include "wakeup.h"
+#include "trace.h"
+#include "pwrmode.h"
 
+/* PWRWU interrupt at lower priority than wake-up source interrupts (default 0), so that it runs after them
+ * on wake-up from power-down and can tell whether the wake-up was handled in interrupt context only. Still
+ * above PendSV/SysTick, which RTX sets to the lowest. RTX SVC_Setup() puts SVCall one level above them
+ * (0xFE << n), i.e. the same second-lowest level as here, so PWRWU and SVC calls don't preempt each other. */
+#define NU_PWRWU_IRQ_PRIORITY       ((1 << __NVIC_PRIO_BITS) - 2)
 
 #if defined(TARGET_NANO100)
 /* Power-down wake-up interrupt handler */
@@ -8,9 +15,17 @@
  * vector handler at link-time. */
 extern "C" void PDWU_IRQHandler(void)
 {
+#if defined(MBED_TICKLESS)
+    TRACE_INSTANT(TraceEvent_Sleep_Wakeup);
+    pwrmode_account_wakeup();
+#endif
+    TRACE_BEGIN(TraceEvent_IRQ_PWRWU);
+
     CLK->WK_INTSTS = CLK_WK_INTSTS_PD_WK_IS_Msk;
     
-    wakeup_eventflags.set(EventFlag_Wakeup_UnID);
+    wakeup_notify_pdwu();
+
+    TRACE_END(TraceEvent_IRQ_PWRWU);
 }
 
 void config_pwrctl(void)
@@ -21,17 +36,31 @@ void config_pwrctl(void)
     /* NOTE: The name of symbol PDWU_IRQHandler is mangled in C++ and cannot override that in startup file in C.
      *       So the NVIC_SetVector call cannot be left out. */
     NVIC_SetVector(PDWU_IRQn, (uint32_t) PDWU_IRQHandler);
+    NVIC_SetPriority(PDWU_IRQn, NU_PWRWU_IRQ_PRIORITY);
     NVIC_EnableIRQ(PDWU_IRQn);
 }
 
+bool wakeup_pdwu_pending(void)
+{
+    return NVIC_GetPendingIRQ(PDWU_IRQn);
+}
+
 #else
 
 /* Power-down wake-up interrupt handler */
 void PWRWU_IRQHandler(void)
 {
+#if defined(MBED_TICKLESS)
+    TRACE_INSTANT(TraceEvent_Sleep_Wakeup);
+    pwrmode_account_wakeup();
+#endif
+    TRACE_BEGIN(TraceEvent_IRQ_PWRWU);
+
     CLK->PWRCTL |= CLK_PWRCTL_PDWKIF_Msk;
     
-    wakeup_eventflags.set(EventFlag_Wakeup_UnID);
+    wakeup_notify_pdwu();
+
+    TRACE_END(TraceEvent_IRQ_PWRWU);
 }
 
 void config_pwrctl(void)
@@ -42,7 +71,13 @@ void config_pwrctl(void)
     /* NOTE: The name of symbol PWRWU_IRQHandler is mangled in C++ and cannot override that in startup file in C.
      *       So the NVIC_SetVector call cannot be left out. */
     NVIC_SetVector(PWRWU_IRQn, (uint32_t) PWRWU_IRQHandler);
+    NVIC_SetPriority(PWRWU_IRQn, NU_PWRWU_IRQ_PRIORITY);
     NVIC_EnableIRQ(PWRWU_IRQn);
 }
 
+bool wakeup_pdwu_pending(void)
+{
+    return NVIC_GetPendingIRQ(PWRWU_IRQn);
+}
+
 #endif
@@ -1,5 +1,8 @@
 #include "mbed.h"
 #include "wakeup.h"
+#include "trace.h"
+#include "pwrmode.h"
+#include "wake_coro.h"
 #include "rtc_api.h"
 #include "mbed_mktime.h"
 
@@ -23,10 +26,18 @@
 /* Start year of H/W RTC */
 #define NU_HWRTC_YEAR0      2000
 
+#if WAKE_CORO_ENABLED
+static WakeTask rtc_task(void);
+#else
 static Semaphore sem_rtc(0, 1);
 
 static void rtc_loop(void);
+#endif
 static void schedule_rtc_alarm(uint32_t secs);
+static const char *rtc_arm_alarm(uint32_t secs);
+
+/* Error of re-arming RTC alarm in interrupt context, where it cannot be printed */
+static const char * volatile rtc_isr_error = NULL;
 
 /* Convert date time from H/W RTC to struct TM */
 static void rtc_convert_datetime_hwrtc_to_tm(struct tm *datetime_tm, const S_RTC_TIME_DATA_T *datetime_hwrtc);
@@ -41,49 +52,96 @@ extern "C" void RTC_IRQHandler(void)
 void RTC_IRQHandler(void)
 #endif
 {
+    TRACE_BEGIN(TraceEvent_IRQ_RTC);
+
     /* Check if RTC alarm interrupt has occurred */
 #if defined(TARGET_NANO100)
     if (RTC->RIIR & RTC_RIIR_AIF_Msk) {
         /* Clear RTC alarm interrupt flag */
         RTC->RIIR = RTC_RIIR_AIF_Msk;
         
-        wakeup_eventflags.set(EventFlag_Wakeup_RTC_Alarm);
+        wakeup_notify(EventFlag_Wakeup_RTC_Alarm);
     }
 #elif defined(TARGET_NUC472)
     if (RTC->INTSTS & RTC_INTSTS_ALMIF_Msk) {
         /* Clear RTC alarm interrupt flag */
         RTC->INTSTS = RTC_INTSTS_ALMIF_Msk;
 
-        wakeup_eventflags.set(EventFlag_Wakeup_RTC_Alarm);
+        wakeup_notify(EventFlag_Wakeup_RTC_Alarm);
     }
 #elif defined(TARGET_M451) || defined(TARGET_M460) || defined(TARGET_M480) || defined(TARGET_M251)
     if (RTC_GET_ALARM_INT_FLAG()) {
         /* Clear RTC alarm interrupt flag */
         RTC_CLEAR_ALARM_INT_FLAG();
 
-        wakeup_eventflags.set(EventFlag_Wakeup_RTC_Alarm);
+        wakeup_notify(EventFlag_Wakeup_RTC_Alarm);
     }
 #else
     if (RTC_GET_ALARM_INT_FLAG(RTC)) {
         /* Clear RTC alarm interrupt flag */
         RTC_CLEAR_ALARM_INT_FLAG(RTC);
 
-        wakeup_eventflags.set(EventFlag_Wakeup_RTC_Alarm);
+        wakeup_notify(EventFlag_Wakeup_RTC_Alarm);
     }
 #endif
 
-    /* Wake up RTC loop to schedule another RTC alarm */
-    sem_rtc.release();
+    if (wakeup_is_isr_only(EventFlag_Wakeup_RTC_Alarm)) {
+        /* Schedule another RTC alarm right here, so no thread needs to run */
+        const char *error = rtc_arm_alarm(3);
+        if (error) {
+            rtc_isr_error = error;
+        }
+    } else {
+        /* Wake up RTC loop to schedule another RTC alarm */
+#if WAKE_CORO_ENABLED
+        wake_coro_post(Source::RtcAlarm);
+#else
+        wake_coro_mark_post(EventFlag_Wakeup_RTC_Alarm);
+        sem_rtc.release();
+#endif
+    }
+
+    TRACE_END(TraceEvent_IRQ_RTC);
 }
 
 void config_rtc_wakeup(void)
 {
+    pwrmode_enable_wakeup_source(EventFlag_Wakeup_RTC_Alarm);
+
+    /* RTC alarm is re-armed in RTC_IRQHandler. No thread is needed. */
+    if (wakeup_is_isr_only(EventFlag_Wakeup_RTC_Alarm)) {
+        schedule_rtc_alarm(3);
+        return;
+    }
+
+#if WAKE_CORO_ENABLED
+    wake_coro_spawn(&rtc_task);
+#else
     static Thread thread_rtc(osPriorityNormal, 2048);
-    
+
+    wake_coro_account_thread(EventFlag_Wakeup_RTC_Alarm, &thread_rtc);
+
     Callback<void()> callback(&rtc_loop);
     thread_rtc.start(callback);
+#endif
 }
 
+#if WAKE_CORO_ENABLED
+WakeTask rtc_task(void)
+{
+    /* Schedule RTC alarm in 3 secs */
+    schedule_rtc_alarm(3);
+
+    while (true) {
+        co_await wake(Source::RtcAlarm);
+        TRACE_BEGIN(TraceEvent_Thread_RTC);
+
+        /* Re-schedule RTC alarm in 3 secs */
+        schedule_rtc_alarm(3);
+        TRACE_END(TraceEvent_Thread_RTC);
+    }
+}
+#else
 void rtc_loop(void)
 {
     /* Schedule RTC alarm in 3 secs */
@@ -91,11 +149,20 @@ void rtc_loop(void)
     
     while (true) {
         sem_rtc.acquire();
+        wake_coro_mark_resume(EventFlag_Wakeup_RTC_Alarm);
+        TRACE_BEGIN(TraceEvent_Thread_RTC);
 
         /* Re-schedule RTC alarm in 3 secs */
         schedule_rtc_alarm(3);
+        TRACE_END(TraceEvent_Thread_RTC);
     }
 }
+#endif
+
+const char *rtc_alarm_error_fetch(void)
+{
+    return (const char *) core_util_atomic_exchange_ptr((void * volatile *) &rtc_isr_error, NULL);
+}
 
 void schedule_rtc_alarm(uint32_t secs)
 {
@@ -112,7 +179,20 @@ void schedule_rtc_alarm(uint32_t secs)
             set_time(CUSTOM_TIME);  // Set RTC time to Wed, 28 Oct 2009 11:35:37
         }
     }
-    
+
+    const char *error = rtc_arm_alarm(secs);
+    if (error) {
+        printf("%s: %s\n", __func__, error);
+    }
+}
+
+/* Re-arm RTC alarm. Callable in interrupt context: no printf and no Mbed OS RTC API, which takes mutex.
+ * Return error description on failure.
+ *
+ * NOTE: This busy-waits for 3 RTC engine clocks (~92 us with LXT, ~300 us with 10 kHz LIRC) through wait_us(),
+ *       which is safe in interrupt context. */
+static const char *rtc_arm_alarm(uint32_t secs)
+{
 #if defined(TARGET_NANO100)
     RTC_DisableInt(RTC_RIER_AIER_Msk);
 #else
@@ -144,8 +224,7 @@ void schedule_rtc_alarm(uint32_t secs)
     
     /* Convert date time of struct TM to POSIX time */
     if (! _rtc_maketime(&datetime_tm_alarm, &t_alarm, RTC_FULL_LEAP_YEAR_SUPPORT)) {
-        printf("%s: _rtc_maketime failed\n", __func__);
-        return;
+        return "_rtc_maketime failed";
     }
 
     /* Calculate RTC alarm time */
@@ -153,8 +232,7 @@ void schedule_rtc_alarm(uint32_t secs)
 
     /* Convert POSIX time to date time of struct TM */
     if (! _rtc_localtime(t_alarm, &datetime_tm_alarm, RTC_FULL_LEAP_YEAR_SUPPORT)) {
-        printf("%s: _rtc_localtime failed\n", __func__);
-        return;
+        return "_rtc_localtime failed";
     }
 
     /* Convert date time from struct TM to H/W RTC */
@@ -177,6 +255,8 @@ void schedule_rtc_alarm(uint32_t secs)
 #else
     RTC_EnableInt(RTC_INTEN_ALMIEN_Msk);
 #endif
+
+    return NULL;
 }
 
 /*
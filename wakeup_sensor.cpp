@@ -0,0 +1,139 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "analogin_api.h"
+#include "trace.h"
+
+#if defined(TARGET_NUMAKER_PFM_NANO130)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_PFM_NUC472)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_PFM_M453)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_PFM_M487)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_IOT_M487)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_IOT_M467)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_IOT_M263A)
+// Analog input
+#define SENSOR_AIN  A0
+
+#elif defined(TARGET_NUMAKER_IOT_M252)
+// Analog input
+#define SENSOR_AIN  A0
+
+#endif
+
+#if defined(SENSOR_AIN) && MBED_CONF_APP_SENSOR_BATCH_ENABLE
+
+/* Batched sensor sampling
+ *
+ * Sampling is triggered by lp_ticker and done in its interrupt context. Samples are collected into RAM
+ * and the application is notified only when one batch is full or threshold is crossed. So the CPU just
+ * wakes up shortly for each sample, without resuming threads or running the main loop.
+ *
+ * NOTE: ADC and PDMA are clocked by HCLK/PCLK which stop in power-down mode (deep sleep), so they cannot
+ *       capture samples autonomously there. Only timer clocked by LXT/LIRC (lp_ticker) keeps running and
+ *       is used as trigger instead.
+ */
+
+#define SENSOR_BATCH_SIZE           MBED_CONF_APP_SENSOR_BATCH_SIZE
+#define SENSOR_SAMPLE_PERIOD_US     (MBED_CONF_APP_SENSOR_SAMPLE_PERIOD_MS * 1000)
+/* Notify early when samples cross this threshold upwards. 0xFFFF to disable it. */
+#define SENSOR_THRESHOLD            MBED_CONF_APP_SENSOR_THRESHOLD
+
+static analogin_t sensor_ain;
+static LowPowerTicker sensor_ticker;
+
+/* Double buffer: one is being filled in interrupt context, the other is ready for fetch */
+static uint16_t batch_buf[2][SENSOR_BATCH_SIZE];
+static uint8_t fill_idx = 0;
+static size_t fill_count = 0;
+static size_t ready_count = 0;
+/* Threshold is edge-triggered: disarmed once crossed, re-armed when samples drop below it again */
+static bool threshold_armed = true;
+
+static void sensor_sample(void);
+
+void config_sensor_batch_wakeup(void)
+{
+    analogin_init(&sensor_ain, SENSOR_AIN);
+
+    sensor_ticker.attach_us(&sensor_sample, SENSOR_SAMPLE_PERIOD_US);
+}
+
+size_t sensor_batch_fetch(uint16_t *buf, size_t max_samples)
+{
+    CriticalSectionLock lock;
+
+    size_t n_samples = ready_count;
+    if (n_samples > max_samples) {
+        n_samples = max_samples;
+    }
+    memcpy(buf, batch_buf[fill_idx ^ 1], n_samples * sizeof (uint16_t));
+    ready_count = 0;
+
+    return n_samples;
+}
+
+static void sensor_sample(void)
+{
+    TRACE_INSTANT(TraceEvent_IRQ_Sensor);
+
+    uint16_t sample = analogin_read_u16(&sensor_ain);
+
+    batch_buf[fill_idx][fill_count ++] = sample;
+
+    bool crossed = false;
+    if (SENSOR_THRESHOLD != 0xFFFF) {
+        if (sample < SENSOR_THRESHOLD) {
+            threshold_armed = true;
+        } else if (threshold_armed) {
+            threshold_armed = false;
+            crossed = true;
+        }
+    }
+
+    if (fill_count < SENSOR_BATCH_SIZE && ! crossed) {
+        /* Handled here. Don't run the main loop for this wake-up. */
+        wakeup_isr_account(EventFlag_Wakeup_SensorBatch, false);
+        return;
+    }
+
+    /* Batch is full or threshold is crossed. Swap buffers and notify. Unfetched batch is overwritten. */
+    ready_count = fill_count;
+    fill_idx ^= 1;
+    fill_count = 0;
+
+    wakeup_notify(EventFlag_Wakeup_SensorBatch);
+}
+
+#else
+
+void config_sensor_batch_wakeup(void)
+{
+    printf("Disable sensor batch wake-up on this target\n\n");
+}
+
+size_t sensor_batch_fetch(uint16_t *buf, size_t max_samples)
+{
+    (void) buf;
+    (void) max_samples;
+
+    return 0;
+}
+
+#endif /* #if defined(SENSOR_AIN) && MBED_CONF_APP_SENSOR_BATCH_ENABLE */
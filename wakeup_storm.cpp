@@ -0,0 +1,221 @@
+#include "mbed.h"
+#include "wakeup.h"
+#include "lp_ticker_api.h"
+
+/* Wake-up storm throttling
+ *
+ * Each wake-up source is rate limited by one token bucket: app.storm-rate events per second with bursts
+ * up to app.storm-burst. On exceeding it, the source is throttled: its mask hook (if any) masks its wake-up
+ * enable, its events are held back and counted as pending, and EventFlag_Wakeup_Storm is notified. After
+ * backoff time, the source is unmasked and the pending events are delivered once as one batch: through its
+ * deliver hook if any, otherwise by notifying the source to the main loop. Backoff doubles if storm resumes
+ * soon after, up to app.storm-backoff-max-ms.
+ *
+ * Sources handing events off to thread (UART CTS, I2C) are throttled in their interrupt handlers through
+ * wakeup_accept(), so that held-back events don't wake up the thread at all.
+ */
+
+/* Fixed-point token: 1 token = 1000000 micro-tokens, so that refill = elapsed us * rate */
+#define NU_STORM_TOKEN              1000000ULL
+
+#define NU_STORM_BACKOFF_MIN_US     (MBED_CONF_APP_STORM_BACKOFF_MIN_MS * 1000)
+#define NU_STORM_BACKOFF_MAX_US     (MBED_CONF_APP_STORM_BACKOFF_MAX_MS * 1000)
+
+/* EventFlag_Wakeup_UnID comes on every wake-up from power-down and EventFlag_Wakeup_Storm is ours.
+ * Never throttle them. */
+#define NU_STORM_EXEMPT             (EventFlag_Wakeup_UnID | EventFlag_Wakeup_Storm)
+
+struct WakeupStorm {
+    uint32_t            rate;
+    uint32_t            burst;
+    uint64_t            tokens;
+    us_timestamp_t      refill_us;
+    bool                throttled;
+    uint32_t            backoff_us;
+    us_timestamp_t      reenable_us;
+    uint32_t            pending;
+    void                (*mask_hook)(uint32_t eventflag, bool masked);
+    bool                (*deliver_hook)(uint32_t eventflag, uint32_t pending);
+    LowPowerTimeout     reenable;
+    /* Statistics */
+    uint32_t            storms;
+    uint32_t            suppressed;
+};
+
+static WakeupStorm storm_arr[NU_WAKEUP_TYPE_NUM];
+/* Sources which have entered storm since last fetch */
+static uint32_t storm_sources = 0;
+
+static void wakeup_storm_init(WakeupStorm *storm);
+static void wakeup_storm_reenable(WakeupStorm *storm);
+
+void wakeup_storm_set_limit(uint32_t eventflag, uint32_t rate, uint32_t burst)
+{
+    MBED_ASSERT(rate);
+
+    CriticalSectionLock lock;
+
+    WakeupStorm *storm = storm_arr + __builtin_ctz(eventflag);
+    wakeup_storm_init(storm);
+    storm->rate = rate;
+    storm->burst = burst;
+    storm->tokens = burst * NU_STORM_TOKEN;
+}
+
+void wakeup_storm_set_mask_hook(uint32_t eventflag, void (*mask_hook)(uint32_t eventflag, bool masked))
+{
+    CriticalSectionLock lock;
+
+    WakeupStorm *storm = storm_arr + __builtin_ctz(eventflag);
+    wakeup_storm_init(storm);
+    storm->mask_hook = mask_hook;
+}
+
+void wakeup_storm_set_deliver_hook(uint32_t eventflag, bool (*deliver_hook)(uint32_t eventflag, uint32_t pending))
+{
+    CriticalSectionLock lock;
+
+    WakeupStorm *storm = storm_arr + __builtin_ctz(eventflag);
+    wakeup_storm_init(storm);
+    storm->deliver_hook = deliver_hook;
+}
+
+uint32_t wakeup_storm_filter(uint32_t eventflag)
+{
+    uint32_t passed = eventflag & NU_STORM_EXEMPT;
+    uint32_t stormed = 0;
+
+    CriticalSectionLock lock;
+
+    us_timestamp_t now_us = ticker_read_us(get_lp_ticker_data());
+
+    for (uint32_t flags = eventflag & ~NU_STORM_EXEMPT; flags; flags &= flags - 1) {
+        uint32_t flag = flags & -flags;
+        WakeupStorm *storm = storm_arr + __builtin_ctz(flag);
+        wakeup_storm_init(storm);
+
+        /* Hold back events of throttled source. They will be delivered on re-enable. */
+        if (storm->throttled) {
+            storm->pending ++;
+            storm->suppressed ++;
+            continue;
+        }
+
+        /* Refill token bucket */
+        storm->tokens += (now_us - storm->refill_us) * storm->rate;
+        if (storm->tokens > storm->burst * NU_STORM_TOKEN) {
+            storm->tokens = storm->burst * NU_STORM_TOKEN;
+        }
+        storm->refill_us = now_us;
+
+        if (storm->tokens >= NU_STORM_TOKEN) {
+            storm->tokens -= NU_STORM_TOKEN;
+            passed |= flag;
+            continue;
+        }
+
+        /* Storm: back off longer if it resumes soon after last re-enable */
+        if (storm->reenable_us && (now_us - storm->reenable_us) < (2 * (us_timestamp_t) storm->backoff_us)) {
+            storm->backoff_us *= 2;
+            if (storm->backoff_us > NU_STORM_BACKOFF_MAX_US) {
+                storm->backoff_us = NU_STORM_BACKOFF_MAX_US;
+            }
+        } else {
+            storm->backoff_us = NU_STORM_BACKOFF_MIN_US;
+        }
+
+        storm->throttled = true;
+        storm->pending = 1;
+        storm->suppressed ++;
+        storm->storms ++;
+        if (storm->mask_hook) {
+            storm->mask_hook(flag, true);
+        }
+        storm->reenable.attach_us(callback(&wakeup_storm_reenable, storm), storm->backoff_us);
+        stormed |= flag;
+    }
+
+    if (stormed) {
+        storm_sources |= stormed;
+        passed |= EventFlag_Wakeup_Storm;
+    }
+
+    return passed;
+}
+
+uint32_t wakeup_storm_fetch(void)
+{
+    CriticalSectionLock lock;
+
+    uint32_t sources = storm_sources;
+    storm_sources = 0;
+    return sources;
+}
+
+void wakeup_storm_dump_stats(void)
+{
+    for (int type = 0; type < NU_WAKEUP_TYPE_NUM; type ++) {
+        uint32_t storms;
+        uint32_t suppressed;
+        {
+            CriticalSectionLock lock;
+            storms = storm_arr[type].storms;
+            suppressed = storm_arr[type].suppressed;
+        }
+
+        if (storms) {
+            printf("Wake-up 0x%03x: %lu storms, %lu events held back\n", 1 << type, (unsigned long) storms,
+                   (unsigned long) suppressed);
+        }
+    }
+}
+
+/* NOTE: Caller must be in critical section. */
+static void wakeup_storm_init(WakeupStorm *storm)
+{
+    if (storm->rate) {
+        return;
+    }
+
+    storm->rate = MBED_CONF_APP_STORM_RATE;
+    storm->burst = MBED_CONF_APP_STORM_BURST;
+    storm->tokens = storm->burst * NU_STORM_TOKEN;
+    storm->refill_us = ticker_read_us(get_lp_ticker_data());
+    storm->backoff_us = NU_STORM_BACKOFF_MIN_US;
+}
+
+static void wakeup_storm_reenable(WakeupStorm *storm)
+{
+    uint32_t flag = 1 << (storm - storm_arr);
+    uint32_t pending;
+    bool (*deliver_hook)(uint32_t eventflag, uint32_t pending);
+
+    {
+        CriticalSectionLock lock;
+
+        storm->throttled = false;
+        storm->reenable_us = ticker_read_us(get_lp_ticker_data());
+        storm->refill_us = storm->reenable_us;
+        pending = storm->pending;
+        storm->pending = 0;
+        deliver_hook = storm->deliver_hook;
+
+        if (storm->mask_hook) {
+            storm->mask_hook(flag, false);
+        }
+    }
+
+    /* Deliver held-back events as one batch. Re-enable timeout wakes up from power-down on its own, so
+     * account it as handled in interrupt context only unless the batch goes on to the main loop. */
+    bool notified = false;
+    if (pending) {
+        if (deliver_hook) {
+            /* Handler runs even if the source is ISR-only, as it does for accepted events */
+            notified = deliver_hook(flag, pending) && ! wakeup_is_isr_only(flag);
+        } else if (! wakeup_is_isr_only(flag)) {
+            notified = true;
+            wakeup_eventflags.set(flag);
+        }
+    }
+    wakeup_isr_account(flag, notified);
+}
@@ -1,5 +1,8 @@
 #include "mbed.h"
 #include "wakeup.h"
+#include "trace.h"
+#include "pwrmode.h"
+#include "wake_coro.h"
 
 #if defined(TARGET_NUMAKER_PFM_NANO130)
 // Serial
@@ -63,25 +66,50 @@
  * on mbed OS) to support wake-up by UART CTS state change. */
 extern "C" void nu_uart_cts_wakeup_handler(UART_T *uart_base);
 
+static void init_serial(void);
+#if WAKE_CORO_ENABLED
+static WakeTask serial_task(void);
+#else
 static void poll_serial(void);
+#endif
 #if MBED_MAJOR_VERSION >= 6
 static void serial_tx_callback(UnbufferedSerial *serial_);
 #else
 static void serial_tx_callback(Serial *serial_);
 #endif
 
+#if (! WAKE_CORO_ENABLED)
 /* Support wake-up by UART CTS state change */
 static Semaphore sem_serial(0, 1);
+#endif
+
+/* UART which has woken us up, for masking its wake-up enable on storm */
+static UART_T * volatile serial_wake_base = NULL;
+
+static void serial_storm_mask(uint32_t eventflag, bool masked);
+static bool serial_storm_deliver(uint32_t eventflag, uint32_t pending);
+static void serial_post(void);
 
 void config_uart_wakeup(void)
 {
+    pwrmode_enable_wakeup_source(EventFlag_Wakeup_UART_CTS);
+    /* Stop bouncing CTS line from waking us up on each change */
+    wakeup_storm_set_mask_hook(EventFlag_Wakeup_UART_CTS, &serial_storm_mask);
+    wakeup_storm_set_deliver_hook(EventFlag_Wakeup_UART_CTS, &serial_storm_deliver);
+
+#if WAKE_CORO_ENABLED
+    wake_coro_spawn(&serial_task);
+#else
     static Thread thread_serial;
-    
+
+    wake_coro_account_thread(EventFlag_Wakeup_UART_CTS, &thread_serial);
+
     Callback<void()> callback(&poll_serial);
     thread_serial.start(callback);
+#endif
 }
 
-static void poll_serial(void)
+static void init_serial(void)
 {
 #if MBED_MAJOR_VERSION >= 6
     static UnbufferedSerial serial(SERIAL_TX, SERIAL_RX);
@@ -99,13 +127,37 @@ static void poll_serial(void)
     Callback<void()> callback((void (*)(Serial *)) &serial_tx_callback, (Serial *) &serial);
 #endif
     serial.attach(callback, mbed::SerialBase::TxIrq);
+}
+
+#if WAKE_CORO_ENABLED
+static WakeTask serial_task(void)
+{
+    init_serial();
+
+    while (true) {
+        co_await wake(Source::UartCts);
+        TRACE_BEGIN(TraceEvent_Thread_Serial);
+
+        wakeup_notify_deferred(EventFlag_Wakeup_UART_CTS);
+        TRACE_END(TraceEvent_Thread_Serial);
+    }
+}
+#else
+static void poll_serial(void)
+{
+    init_serial();
     
     while (true) {
         sem_serial.acquire();
+        wake_coro_mark_resume(EventFlag_Wakeup_UART_CTS);
+        TRACE_BEGIN(TraceEvent_Thread_Serial);
 
-        wakeup_eventflags.set(EventFlag_Wakeup_UART_CTS);
+        wakeup_notify_deferred(EventFlag_Wakeup_UART_CTS);
+        TRACE_END(TraceEvent_Thread_Serial);
     }
 }
+#endif
+
 #if MBED_MAJOR_VERSION >= 6
 static void serial_tx_callback(UnbufferedSerial *serial_)
 #else
@@ -117,9 +169,60 @@ static void serial_tx_callback(Serial *serial_)
 
 void nu_uart_cts_wakeup_handler(UART_T *uart_base)
 {
-    (void) uart_base;
+    TRACE_BEGIN(TraceEvent_IRQ_UART_CTS);
+
+    serial_wake_base = uart_base;
 
     /* FIXME: Clear wake-up event to enable re-entering Power-down mode */
 
+    /* Throttle storm here rather than in thread, so that held-back events don't wake up thread */
+    if (wakeup_accept(EventFlag_Wakeup_UART_CTS)) {
+        serial_post();
+    }
+
+    TRACE_END(TraceEvent_IRQ_UART_CTS);
+}
+
+/* Hand event off to thread */
+static void serial_post(void)
+{
+#if WAKE_CORO_ENABLED
+    wake_coro_post(Source::UartCts);
+#else
+    wake_coro_mark_post(EventFlag_Wakeup_UART_CTS);
     sem_serial.release();
+#endif
+}
+
+/* NOTE: Called in critical section */
+static void serial_storm_mask(uint32_t eventflag, bool masked)
+{
+    (void) eventflag;
+
+#if defined(TARGET_M451) || defined(TARGET_M480) || defined(TARGET_M460) || defined(TARGET_M261) || defined(TARGET_M251)
+    UART_T *uart_base = serial_wake_base;
+    if (uart_base == NULL) {
+        return;
+    }
+
+    if (masked) {
+        uart_base->WKCTL &= ~UART_WKCTL_WKCTSEN_Msk;
+    } else {
+        uart_base->WKCTL |= UART_WKCTL_WKCTSEN_Msk;
+    }
+#else
+    /* NOTE: No separate CTS wake-up enable on NUC472/NANO100. Held-back events still wake up CPU but are
+     *       dropped in nu_uart_cts_wakeup_handler(). */
+    (void) masked;
+#endif
+}
+
+/* Held-back events were dropped in interrupt handler. Run thread once for the whole batch. */
+static bool serial_storm_deliver(uint32_t eventflag, uint32_t pending)
+{
+    (void) eventflag;
+    (void) pending;
+
+    serial_post();
+    return true;
 }
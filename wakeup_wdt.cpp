@@ -6,6 +6,9 @@
 
 #include "mbed.h"
 #include "wakeup.h"
+#include "clk_gate.h"
+#include "trace.h"
+#include "pwrmode.h"
 
 #if defined(TARGET_NANO100)
 /* This target doesn't support relocating vector table and requires overriding 
@@ -15,6 +18,8 @@ extern "C" void WDT_IRQHandler(void)
 void WDT_IRQHandler(void)
 #endif
 {
+    TRACE_BEGIN(TraceEvent_IRQ_WDT);
+
     /* Check WDT interrupt flag */
     if (WDT_GET_TIMEOUT_INT_FLAG()) {
         WDT_CLEAR_TIMEOUT_INT_FLAG();
@@ -25,14 +30,19 @@ void WDT_IRQHandler(void)
     if (WDT_GET_TIMEOUT_WAKEUP_FLAG()) {
         WDT_CLEAR_TIMEOUT_WAKEUP_FLAG();
         
-        wakeup_eventflags.set(EventFlag_Wakeup_WDT_Timeout);
+        wakeup_notify(EventFlag_Wakeup_WDT_Timeout);
     }
+
+    TRACE_END(TraceEvent_IRQ_WDT);
 }
 
 void config_wdt_wakeup()
 {
-    /* Enable IP module clock */
-    CLK_EnableModuleClock(WDT_MODULE);
+    /* Enable IP module clock
+     *
+     * WDT is clocked by LIRC which keeps running in power-down mode (deep sleep), so no clock source
+     * switch is needed across power-down. */
+    clk_gate_acquire(WDT_MODULE);
 
     /* Select IP clock source */
 #if defined(TARGET_NANO100)
@@ -60,6 +70,8 @@ void config_wdt_wakeup()
     /* Enable WDT timeout interrupt */
     WDT_EnableInt();
     SYS_LockReg();
+
+    pwrmode_enable_wakeup_source(EventFlag_Wakeup_WDT_Timeout);
 }
 
 #else